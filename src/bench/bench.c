@@ -0,0 +1,1578 @@
+#include "../lang-model/model.h"
+#include "../transform-model/model.h"
+#include "../ht/hash_table.h"
+#include "../ht/frozen_hash_table.h"
+#include "../ht/concurrent_hash_table.h"
+#include "../ht/alloc_stats.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define BUILD_RUNS 3
+#define SCORE_TEXTS 64
+#define SCORE_BYTES_PER_LENGTH 0x400000
+#define FIXED_POINT_TOLERANCE 0.005
+#define DEFAULT_HIGH_ORDER_KIB 4096
+#define HASH_LOOKUP_ROUNDS 5
+#define WORD_FILTER_LENGTH 100
+#define CONCURRENT_READ_ROUNDS 3
+#define HASH_FUNCTION_ROUNDS 20
+#define KEY_ACCESS_SAMPLES 1000
+#define SUITE_WARMUP_RUNS 2
+#define SUITE_RUNS 15
+#define SUITE_RANDOM_PROGRAMS 32
+#define SUITE_PROGRAM_SIZE 512
+#define SUITE_SCORE_ROUNDS 64
+
+const char* SAMPLE_WORDS[] = {
+    "flag", "stars", "are", "made", "of", "weird", "stuff", "the", "quick",
+    "brown", "fox", "jumps", "over", "lazy", "dog", "cosmos", "light",
+    "universe", "and", "planets", "with", "distant", "galaxies", NULL
+};
+
+const int SCORE_LENGTHS[] = { 30, 100, 500, 0 };
+const int FIXED_POINT_LENGTHS[] = { 30, 100, 250, 500, 0 };
+const int FIXED_POINT_GARBAGE_LENGTHS[] = { 1000, 70000, 100000, 1000000, 0 };
+const double WORD_FILTER_RATES[] = { 0.1, 0.01, 0.001, 0 };
+
+// Cat, add one, walks both ways and nested counting loops
+const char* SUITE_PROGRAMS[] = {
+    "+[,.]", "+[,+.]", "+[>,.]", "+[<,.]",
+    "++++++++[>++++++++[>+>++<<-]<-]>>.>.", NULL
+};
+const char* SUITE_INPUT = "flag stars are made of weird stuff";
+
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static language_model* timed_build_with_options(
+    const char* fname, const language_model_options* options,
+    double* seconds, long* size){
+
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL){
+        perror(fname);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+
+    double start = now();
+    language_model* model = build_language_model_with_options(f, options);
+    *seconds = now() - start;
+
+    fclose(f);
+
+    return model;
+}
+
+
+static language_model* timed_build(const char* fname, int threads,
+                                   double* seconds, long* size){
+
+    language_model_options options;
+    language_model_default_options(&options);
+    options.build_threads = threads;
+
+    return timed_build_with_options(fname, &options, seconds, size);
+}
+
+
+// Seeded garbage, like most of the evolved outputs
+static void random_text(char* text, int length){
+    int i;
+    for (i = 0; i < length; i++){
+        text[i] = 1 + rand() % 255;
+    }
+    text[length] = '\0';
+}
+
+
+// Space separated words
+static void words_text(char* text, int length){
+    int count = 0, pos = 0;
+
+    while (SAMPLE_WORDS[count] != NULL){
+        count++;
+    }
+
+    while (pos < length){
+        const char* word = SAMPLE_WORDS[rand() % count];
+        int i;
+
+        for (i = 0; (word[i] != '\0') && (pos < length); i++){
+            text[pos++] = word[i];
+        }
+        if (pos < length){
+            text[pos++] = ' ';
+        }
+    }
+    text[length] = '\0';
+}
+
+
+// Words with no spaces between them, like a decoder that loses them
+static void unspaced_words_text(char* text, int length){
+    int count = 0, pos = 0;
+
+    while (SAMPLE_WORDS[count] != NULL){
+        count++;
+    }
+
+    while (pos < length){
+        const char* word = SAMPLE_WORDS[rand() % count];
+        int i;
+
+        for (i = 0; (word[i] != '\0') && (pos < length); i++){
+            text[pos++] = word[i];
+        }
+    }
+    text[length] = '\0';
+}
+
+
+// Runs of random letters, all word candidates and nearly all misses
+static void letters_text(char* text, int length){
+    int i;
+    for (i = 0; i < length; i++){
+        text[i] = (rand() % 6) == 0 ? ' ' : 'a' + rand() % 26;
+    }
+    text[length] = '\0';
+}
+
+
+// Words with a tenth of their characters replaced, like near solutions
+static void noisy_words_text(char* text, int length){
+    int i;
+
+    words_text(text, length);
+    for (i = 0; i < length; i++){
+        if ((rand() % 10) == 0){
+            text[i] = 1 + rand() % 255;
+        }
+    }
+}
+
+
+static double score_ns_per_byte(const language_model* model,
+                                void (*generate)(char*, int), int length){
+    char* texts[SCORE_TEXTS];
+    int i, round, rounds = SCORE_BYTES_PER_LENGTH / (length * SCORE_TEXTS) + 1;
+    unsigned long sink = 0;
+
+    srand(length);
+    for (i = 0; i < SCORE_TEXTS; i++){
+        texts[i] = malloc(length + 1);
+        generate(texts[i], length);
+    }
+
+    double start = now();
+    for (round = 0; round < rounds; round++){
+        for (i = 0; i < SCORE_TEXTS; i++){
+            sink += language_model_score(model, texts[i]);
+        }
+    }
+    double seconds = now() - start;
+
+    for (i = 0; i < SCORE_TEXTS; i++){
+        free(texts[i]);
+    }
+
+    // Keep the scores alive
+    if (sink == 1){
+        printf(" ");
+    }
+
+    return (seconds * 1e9) / ((double) rounds * SCORE_TEXTS * length);
+}
+
+
+/*
+ * Scoring cost per byte, without and with the 4/5-gram tier.
+ */
+int bench_score(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "score <corpus> [high order KiB]\n");
+        return 1;
+    }
+
+    language_model_options options;
+    language_model_default_options(&options);
+
+    double seconds;
+    long size;
+    language_model* model = timed_build_with_options(argv[0], &options,
+                                                     &seconds, &size);
+
+    options.high_order_bytes = (argc > 1 ? strtoul(argv[1], NULL, 10)
+                                : DEFAULT_HIGH_ORDER_KIB) * 1024;
+    language_model* high_order_model = timed_build_with_options(
+        argv[0], &options, &seconds, &size);
+
+    if ((model == NULL) || (high_order_model == NULL)){
+        free_language_model(model);
+        free_language_model(high_order_model);
+        return 2;
+    }
+
+    int i;
+    for (i = 0; SCORE_LENGTHS[i] != 0; i++){
+        int length = SCORE_LENGTHS[i];
+
+        printf("score len=%-4i garbage %7.2f ns/B  words %7.2f ns/B  "
+               "| high order: garbage %7.2f ns/B  words %7.2f ns/B\n",
+               length,
+               score_ns_per_byte(model, random_text, length),
+               score_ns_per_byte(model, words_text, length),
+               score_ns_per_byte(high_order_model, random_text, length),
+               score_ns_per_byte(high_order_model, words_text, length));
+    }
+
+    free_language_model(model);
+    free_language_model(high_order_model);
+
+    return 0;
+}
+
+
+/*
+ * Scoring cost per byte with the word filter at several false positive
+ * rates, and the rate measured on letter garbage.
+ */
+int bench_word_filter(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "words <corpus> [rate...]\n");
+        return 1;
+    }
+
+    double seconds;
+    long size;
+    language_model* model = timed_build(argv[0], 1, &seconds, &size);
+    if (model == NULL){
+        return 2;
+    }
+
+    printf("no filter                           letters %7.2f ns/B  "
+           "words %7.2f ns/B\n",
+           score_ns_per_byte(model, letters_text, WORD_FILTER_LENGTH),
+           score_ns_per_byte(model, words_text, WORD_FILTER_LENGTH));
+
+    int i, rates = argc > 1 ? argc - 1 : 0;
+    for (i = 0; rates > 0 ? i < rates : WORD_FILTER_RATES[i] != 0; i++){
+        double rate = rates > 0 ? atof(argv[i + 1]) : WORD_FILTER_RATES[i];
+        word_filter_stats stats;
+
+        if (!language_model_enable_word_filter(model, rate)){
+            fprintf(stderr, "Invalid rate %g\n", rate);
+            continue;
+        }
+
+        double letters = score_ns_per_byte(model, letters_text,
+                                           WORD_FILTER_LENGTH);
+        language_model_word_filter_stats(model, &stats);
+
+        unsigned long misses = stats.candidates - stats.hits;
+        unsigned long false_positives = misses - stats.rejects;
+
+        printf("filter rate=%-6g %5zu KiB  fp %6.4f  letters %7.2f ns/B  "
+               "words %7.2f ns/B\n",
+               rate, stats.bytes / 1024,
+               misses > 0 ? (double) false_positives / misses : 0,
+               letters,
+               score_ns_per_byte(model, words_text, WORD_FILTER_LENGTH));
+    }
+
+    free_language_model(model);
+
+    return 0;
+}
+
+
+static void print_word_engine_costs(const char* engine,
+                                    const language_model* model){
+    int i;
+
+    for (i = 0; SCORE_LENGTHS[i] != 0; i++){
+        int length = SCORE_LENGTHS[i];
+
+        printf("%-9s len=%-4i garbage %7.2f ns/B  words %7.2f ns/B  "
+               "unspaced %7.2f ns/B  noisy %7.2f ns/B\n",
+               engine, length,
+               score_ns_per_byte(model, random_text, length),
+               score_ns_per_byte(model, words_text, length),
+               score_ns_per_byte(model, unspaced_words_text, length),
+               score_ns_per_byte(model, noisy_words_text, length));
+    }
+}
+
+
+/*
+ * Scoring cost per byte with the delimited and the automaton word engines.
+ */
+int bench_automaton(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "automaton <corpus> [min word length]\n");
+        return 1;
+    }
+
+    double seconds;
+    long size;
+    language_model* model = timed_build(argv[0], 1, &seconds, &size);
+    if (model == NULL){
+        return 2;
+    }
+
+    print_word_engine_costs("delimited", model);
+
+    double start = now();
+    if (!language_model_set_word_engine(model, LANGUAGE_MODEL_AUTOMATON_WORDS,
+                                        argc > 1 ? atoi(argv[1]) : 2)){
+        fprintf(stderr, "Error compiling the automaton\n");
+        free_language_model(model);
+        return 3;
+    }
+    printf("automaton compiled in %.2f ms\n", (now() - start) * 1e3);
+
+    print_word_engine_costs("automaton", model);
+
+    free_language_model(model);
+
+    return 0;
+}
+
+
+/*
+ * Model build throughput, each thread count is checked against the
+ * single threaded build.
+ */
+int bench_build(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "build <corpus> [threads...]\n");
+        return 1;
+    }
+
+    double seconds;
+    long size;
+    language_model* reference = timed_build(argv[0], 1, &seconds, &size);
+    if (reference == NULL){
+        return 2;
+    }
+
+    int default_threads[] = { 1, 2, 4, 8 };
+    int thread_count = argc > 1 ? argc - 1 : 4;
+    int i, run;
+
+    for (i = 0; i < thread_count; i++){
+        int threads = argc > 1 ? atoi(argv[i + 1]) : default_threads[i];
+        double best = -1;
+        int equal = 1;
+
+        for (run = 0; run < BUILD_RUNS; run++){
+            language_model* model = timed_build(argv[0], threads, &seconds, &size);
+            if (model == NULL){
+                free_language_model(reference);
+                return 2;
+            }
+
+            equal = equal && (compare_language_models(reference, model) == 0);
+            if ((best < 0) || (seconds < best)){
+                best = seconds;
+            }
+
+            free_language_model(model);
+        }
+
+        printf("build threads=%-3i %8.2f MB/s  %s\n", threads,
+               (size / (1024.0 * 1024.0)) / best,
+               equal ? "same as serial" : "DIFFERENT FROM SERIAL");
+    }
+
+    free_language_model(reference);
+
+    return 0;
+}
+
+
+/*
+ * What `happy score` pays before and after scoring: building the model
+ * (reading, counting and freezing the words) and freeing it.
+ */
+int bench_lifecycle(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "lifecycle <corpus>\n");
+        return 1;
+    }
+
+    double best_build = -1, best_free = -1;
+    int run;
+
+    for (run = 0; run < BUILD_RUNS; run++){
+        double seconds;
+        long size;
+        language_model* model = timed_build(argv[0], 1, &seconds, &size);
+        if (model == NULL){
+            return 2;
+        }
+
+        if ((best_build < 0) || (seconds < best_build)){
+            best_build = seconds;
+        }
+
+        double start = now();
+        free_language_model(model);
+        seconds = now() - start;
+
+        if ((best_free < 0) || (seconds < best_free)){
+            best_free = seconds;
+        }
+    }
+
+    printf("lifecycle build %8.2f ms  free %8.2f ms\n",
+           best_build * 1e3, best_free * 1e3);
+
+    return 0;
+}
+
+
+// Relative difference of a fixed point score, 0 within a unit
+static double fixed_point_error(unsigned long floating, unsigned long fixed){
+    unsigned long diff = floating > fixed ? floating - fixed : fixed - floating;
+
+    return diff > 1 ? (double) diff / floating : 0;
+}
+
+
+/*
+ * Floating point vs fixed point scoring: cost per byte, worst relative
+ * difference and how many pairs of outputs keep their order. Then words
+ * after garbage as long as evolved outputs get. Fails if any score is off
+ * by more than FIXED_POINT_TOLERANCE.
+ */
+int bench_fixed(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "fixed <corpus>\n");
+        return 1;
+    }
+
+    double seconds;
+    long size;
+    language_model* model = timed_build(argv[0], 1, &seconds, &size);
+    if (model == NULL){
+        return 2;
+    }
+
+    void (*generators[])(char*, int) = { random_text, words_text, noisy_words_text };
+    const int generator_count = 3;
+    const int text_count = SCORE_TEXTS * generator_count;
+    int i, failed = 0;
+
+    for (i = 0; FIXED_POINT_LENGTHS[i] != 0; i++){
+        int length = FIXED_POINT_LENGTHS[i];
+        char* texts[text_count];
+        unsigned long floating[text_count];
+        unsigned long fixed[text_count];
+        double max_error = 0;
+        long pairs = 0, same_order = 0;
+        double float_ns = 0, fixed_ns = 0;
+        int g, j, k;
+
+        srand(length);
+        for (j = 0; j < text_count; j++){
+            texts[j] = malloc(length + 1);
+            generators[j % generator_count](texts[j], length);
+        }
+
+        for (j = 0; j < text_count; j++){
+            language_model_set_fixed_point(model, 0);
+            floating[j] = language_model_score(model, texts[j]);
+
+            language_model_set_fixed_point(model, 1);
+            fixed[j] = language_model_score(model, texts[j]);
+
+            double error = fixed_point_error(floating[j], fixed[j]);
+            if (error > max_error){
+                max_error = error;
+            }
+        }
+
+        for (j = 0; j < text_count; j++){
+            for (k = j + 1; k < text_count; k++){
+                pairs++;
+                same_order += ((floating[j] < floating[k]) == (fixed[j] < fixed[k]))
+                    && ((floating[j] == floating[k]) == (fixed[j] == fixed[k]));
+            }
+        }
+
+        for (g = 0; g < 2; g++){
+            language_model_set_fixed_point(model, g);
+            double ns = score_ns_per_byte(model, generators[0], length) / 3
+                + score_ns_per_byte(model, generators[1], length) / 3
+                + score_ns_per_byte(model, generators[2], length) / 3;
+
+            if (g){
+                fixed_ns = ns;
+            }
+            else {
+                float_ns = ns;
+            }
+        }
+
+        printf("fixed len=%-4i float %7.2f ns/B  fixed %7.2f ns/B  (x%.2f)  "
+               "max error %.4f%%  same order %.3f%%\n",
+               length, float_ns, fixed_ns, float_ns / fixed_ns,
+               max_error * 100, (100.0 * same_order) / pairs);
+
+        for (j = 0; j < text_count; j++){
+            free(texts[j]);
+        }
+        failed |= max_error > FIXED_POINT_TOLERANCE;
+    }
+
+    const char* words = " flag stars are made of weird stuff";
+    for (i = 0; FIXED_POINT_GARBAGE_LENGTHS[i] != 0; i++){
+        int length = FIXED_POINT_GARBAGE_LENGTHS[i];
+        char* text = malloc(length + strlen(words) + 1);
+
+        memset(text, '#', length);
+        strcpy(&text[length], words);
+
+        language_model_set_fixed_point(model, 0);
+        unsigned long floating = language_model_score(model, text);
+        language_model_set_fixed_point(model, 1);
+        unsigned long fixed = language_model_score(model, text);
+        double error = fixed_point_error(floating, fixed);
+
+        printf("fixed garbage=%-7i float %8lu  fixed %8lu  error %.4f%%\n",
+               length, floating, fixed, error * 100);
+
+        failed |= error > FIXED_POINT_TOLERANCE;
+        free(text);
+    }
+
+    free_language_model(model);
+
+    return failed ? 3 : 0;
+}
+
+
+static char** read_words(const char* fname, size_t* count){
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL){
+        perror(fname);
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    char** words = malloc(sizeof(char*) * capacity);
+    char word[256];
+
+    *count = 0;
+    while (fscanf(f, "%255s", word) == 1){
+        if (*count == capacity){
+            capacity *= 2;
+            words = realloc(words, sizeof(char*) * capacity);
+        }
+        words[(*count)++] = strdup(word);
+    }
+
+    fclose(f);
+
+    return words;
+}
+
+
+static void free_words(char** words, size_t count){
+    size_t i;
+    for (i = 0; i < count; i++){
+        free(words[i]);
+    }
+    free(words);
+}
+
+
+// Alphabetic garbage of dictionary-like lengths, misses almost always
+static char** garbage_words(size_t count){
+    char** words = malloc(sizeof(char*) * count);
+    size_t i;
+
+    srand(count);
+    for (i = 0; i < count; i++){
+        int length = 2 + rand() % 9, j;
+
+        words[i] = malloc(length + 1);
+        for (j = 0; j < length; j++){
+            words[i][j] = 'a' + rand() % 26;
+        }
+        words[i][length] = '\0';
+    }
+
+    return words;
+}
+
+
+static double lookup_ns(hash_table_t table, char** words, size_t count){
+    size_t i;
+    int round;
+    long found = 0;
+
+    double start = now();
+    for (round = 0; round < HASH_LOOKUP_ROUNDS; round++){
+        for (i = 0; i < count; i++){
+            found += get_hash_table(table, words[i]) != NULL;
+        }
+    }
+    double seconds = now() - start;
+
+    // Keep the lookups alive
+    if (found == -1){
+        printf(" ");
+    }
+
+    return (seconds * 1e9) / (count * HASH_LOOKUP_ROUNDS);
+}
+
+
+static double frozen_lookup_ns(frozen_hash_table_t table, char** words,
+                               size_t count){
+    size_t i;
+    int round;
+    long found = 0;
+
+    double start = now();
+    for (round = 0; round < HASH_LOOKUP_ROUNDS; round++){
+        for (i = 0; i < count; i++){
+            found += get_frozen_hash_table(table, words[i]) != NULL;
+        }
+    }
+    double seconds = now() - start;
+
+    if (found == -1){
+        printf(" ");
+    }
+
+    return (seconds * 1e9) / (count * HASH_LOOKUP_ROUNDS);
+}
+
+
+// Writes the frozen table to a file and maps it back
+static int frozen_round_trip(frozen_hash_table_t table, char** words,
+                             size_t count){
+    FILE *f = tmpfile();
+    if ((f == NULL) || !write_frozen_hash_table(table, f) || (fflush(f) != 0)){
+        perror("frozen table");
+        return 0;
+    }
+
+    size_t size = frozen_hash_table_size(table);
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    fclose(f);
+    if (image == MAP_FAILED){
+        perror("frozen table");
+        return 0;
+    }
+
+    frozen_hash_table_t loaded = load_frozen_hash_table(image, size);
+    int same = loaded != NULL;
+    size_t i;
+
+    for (i = 0; same && (i < count); i++){
+        same = get_frozen_hash_table(loaded, words[i])
+            == get_frozen_hash_table(table, words[i]);
+    }
+
+    free_frozen_hash_table(loaded);
+    munmap(image, size);
+
+    return same;
+}
+
+
+// Enumerates the table keys, and reads some of them by index, returns if
+// all of them were found
+static int print_key_access(hash_table_t table){
+    size_t count = hash_table_count(table), i, found = 0;
+    const char *key;
+
+    double start = now();
+    vector_t *keys = get_hash_table_str_keys(table);
+    double vector_build = now() - start;
+
+    start = now();
+    for (i = 0; i < KEY_ACCESS_SAMPLES; i++){
+        found += *(char *) vector_element(keys, (i * 7919) % count) != '\0';
+    }
+    double vector_access = now() - start;
+
+    hash_table_iterator_t it = hash_table_iterator(table);
+    start = now();
+    llist_t *list = create_llist();
+    while (hash_table_next(&it, &key, NULL)){
+        add_to_llist(list, (void *) key);
+    }
+    double list_build = now() - start;
+
+    start = now();
+    for (i = 0; i < KEY_ACCESS_SAMPLES; i++){
+        found += *(char *) llist_element(list, (i * 7919) % count) != '\0';
+    }
+    double list_access = now() - start;
+
+    printf("keys=%zu  vector build %7.2f ms  index %9.2f ns  "
+           "list build %7.2f ms  index %9.2f ns  %s\n",
+           count, vector_build * 1e3, (vector_access * 1e9) / KEY_ACCESS_SAMPLES,
+           list_build * 1e3, (list_access * 1e9) / KEY_ACCESS_SAMPLES,
+           found == 2 * KEY_ACCESS_SAMPLES ? "" : "MISSING KEYS");
+
+    free_vector(keys, NULL);
+    free_llist(list, NULL);
+
+    return found == 2 * KEY_ACCESS_SAMPLES;
+}
+
+
+/*
+ * Hash table insert, hit and miss latency on the corpus words, and the same
+ * lookups on its frozen version.
+ */
+int bench_hash(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "hash <corpus>\n");
+        return 1;
+    }
+
+    size_t count, i;
+    char** words = read_words(argv[0], &count);
+    if (words == NULL){
+        return 2;
+    }
+    char** garbage = garbage_words(count);
+
+    double start = now();
+    hash_table_t table = create_hash_table();
+    for (i = 0; i < count; i++){
+        insert_hash_table(table, words[i], (void*) (i + 1));
+    }
+    double insert_seconds = now() - start;
+
+    double hit = lookup_ns(table, words, count);
+    double miss = lookup_ns(table, garbage, count);
+
+    start = now();
+    frozen_hash_table_t frozen = freeze_hash_table(table);
+    double freeze_seconds = now() - start;
+    if (frozen == NULL){
+        fprintf(stderr, "Error freezing the table\n");
+        return 3;
+    }
+
+    int keys_found = print_key_access(table);
+
+    start = now();
+    free_hash_table(table, NULL);
+    double free_seconds = now() - start;
+
+    printf("hash keys=%zu  insert %7.2f ns  hit %7.2f ns  miss %7.2f ns  "
+           "free %7.2f ms\n",
+           count, (insert_seconds * 1e9) / count, hit, miss,
+           free_seconds * 1e3);
+
+    // The same keys in a table whose keys go to a shared arena
+    start = now();
+    arena_t *arena = create_arena(0);
+    hash_table_t shared = create_hash_table_with_arena(0, arena);
+    for (i = 0; i < count; i++){
+        insert_hash_table(shared, words[i], (void*) (i + 1));
+    }
+    insert_seconds = now() - start;
+
+    size_t arena_bytes = arena_size(arena);
+
+    start = now();
+    free_hash_table(shared, NULL);
+    free_arena(arena);
+    free_seconds = now() - start;
+
+    printf("arena keys=%zu  insert %7.2f ns  free %7.2f ms  keys %zu KiB\n",
+           count, (insert_seconds * 1e9) / count, free_seconds * 1e3,
+           arena_bytes / 1024);
+
+    int reloads = frozen_round_trip(frozen, words, count);
+    printf("frozen keys=%zu  freeze %7.2f ms  hit %7.2f ns  miss %7.2f ns  "
+           "image %zu KiB  %s\n",
+           frozen_hash_table_count(frozen), freeze_seconds * 1e3,
+           frozen_lookup_ns(frozen, words, count),
+           frozen_lookup_ns(frozen, garbage, count),
+           frozen_hash_table_size(frozen) / 1024,
+           reloads ? "reloads" : "RELOAD FAILED");
+
+    free_frozen_hash_table(frozen);
+    free_words(words, count);
+    free_words(garbage, count);
+
+    return (keys_found && reloads) ? 0 : 3;
+}
+
+
+struct named_hash_function {
+    const char* name;
+    hash_function_t f;
+};
+
+const struct named_hash_function HASH_FUNCTIONS[] = {
+    { "wyhash", wy_hash },
+    { "one-at-a-time", one_at_a_time_hash },
+    { "fnv1a", fnv1a_hash },
+    { NULL, NULL }
+};
+
+
+static double hash_ns(hash_function_t f, char** words, const size_t* lengths,
+                      size_t count){
+    volatile hash_t sink = 0;
+    hash_t h = 0;
+    size_t i;
+    int round;
+
+    double start = now();
+    for (round = 0; round < HASH_FUNCTION_ROUNDS; round++){
+        for (i = 0; i < count; i++){
+            h += f(words[i], lengths[i]);
+        }
+    }
+    sink = h;
+    (void) sink;
+
+    return ((now() - start) * 1e9) / (count * HASH_FUNCTION_ROUNDS);
+}
+
+
+/*
+ * Colliding pairs when the hashes are spread over a power of two number of
+ * buckets, by the low bits (slot masks) or the high ones (shards, filter
+ * blocks), relative to a uniformly random hash: 1.00 is ideal.
+ */
+static double collision_ratio(const hash_t* hashes, size_t count, int bits,
+                              int high){
+    size_t buckets = ((size_t) 1) << bits;
+    unsigned int* load = calloc(buckets, sizeof(unsigned int));
+    double pairs = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++){
+        size_t bucket = high ? (hashes[i] >> (64 - bits))
+                             : (hashes[i] & (buckets - 1));
+        pairs += load[bucket]++;
+    }
+    free(load);
+
+    return pairs / (((double) count * (count - 1)) / (2.0 * buckets));
+}
+
+
+static int compare_hashes(const void* a, const void* b){
+    hash_t x = *(const hash_t*) a, y = *(const hash_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+
+static int compare_words(const void* a, const void* b){
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+
+// Sorts the words and drops the repeated ones, returns the distinct count
+static size_t unique_words(char** words, size_t count){
+    size_t i, unique = 0;
+
+    qsort(words, count, sizeof(char*), compare_words);
+    for (i = 0; i < count; i++){
+        if ((unique > 0) && (strcmp(words[unique - 1], words[i]) == 0)){
+            free(words[i]);
+        }
+        else {
+            words[unique++] = words[i];
+        }
+    }
+
+    return unique;
+}
+
+
+static void print_hash_quality(const char* set, hash_function_t f,
+                               const char* name, char** words, size_t count){
+    size_t* lengths = malloc(sizeof(size_t) * count);
+    hash_t* hashes = malloc(sizeof(hash_t) * count);
+    size_t i, collisions = 0;
+    int bits = 1;
+
+    for (i = 0; i < count; i++){
+        lengths[i] = strlen(words[i]);
+        hashes[i] = f(words[i], lengths[i]);
+    }
+    while ((((size_t) 1) << bits) < count){
+        bits++;
+    }
+
+    printf("%-8s %-14s %6.2f ns/key  low bits %5.3f  high bits %5.3f",
+           set, name, hash_ns(f, words, lengths, count),
+           collision_ratio(hashes, count, bits, 0),
+           collision_ratio(hashes, count, bits, 1));
+
+    // Equal low halves, the part of the hash table slots keep
+    for (i = 0; i < count; i++){
+        hashes[i] &= 0xffffffffUL;
+    }
+    qsort(hashes, count, sizeof(hash_t), compare_hashes);
+    for (i = 1; i < count; i++){
+        collisions += hashes[i] == hashes[i - 1];
+    }
+    printf("  32 bit collisions %zu\n", collisions);
+
+    free(lengths);
+    free(hashes);
+}
+
+
+/*
+ * Speed and bucket spread of the available string hashes, on the corpus
+ * words and on garbage words of similar lengths.
+ */
+int bench_hash_functions(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "hashes <corpus>\n");
+        return 1;
+    }
+
+    size_t count;
+    char** words = read_words(argv[0], &count);
+    if (words == NULL){
+        return 2;
+    }
+    char** garbage = garbage_words(count);
+    size_t garbage_count = unique_words(garbage, count);
+    int i;
+
+    // Repeated keys would count as collisions
+    count = unique_words(words, count);
+
+    for (i = 0; HASH_FUNCTIONS[i].name != NULL; i++){
+        print_hash_quality("words", HASH_FUNCTIONS[i].f, HASH_FUNCTIONS[i].name,
+                           words, count);
+    }
+    for (i = 0; HASH_FUNCTIONS[i].name != NULL; i++){
+        print_hash_quality("garbage", HASH_FUNCTIONS[i].f, HASH_FUNCTIONS[i].name,
+                           garbage, garbage_count);
+    }
+
+    free_words(words, count);
+    free_words(garbage, garbage_count);
+
+    return 0;
+}
+
+
+struct contention_job {
+    char** words;
+    size_t start;
+    size_t end;
+
+    concurrent_hash_table_t table;
+
+    // Baseline, a plain table behind one lock
+    hash_table_t locked_table;
+    pthread_mutex_t* lock;
+};
+
+
+static void *concurrent_add_job(void *_job){
+    struct contention_job *job = _job;
+    size_t i;
+
+    for (i = job->start; i < job->end; i++){
+        add_concurrent_hash_table_n(job->table, job->words[i],
+                                    strlen(job->words[i]), 1);
+    }
+
+    return NULL;
+}
+
+
+static void *concurrent_read_job(void *_job){
+    struct contention_job *job = _job;
+    long found = 0;
+    size_t i;
+    int round;
+
+    for (round = 0; round < CONCURRENT_READ_ROUNDS; round++){
+        for (i = job->start; i < job->end; i++){
+            found += get_concurrent_hash_table(job->table, job->words[i]) != NULL;
+        }
+    }
+
+    return (void*) found;
+}
+
+
+// Each word is looked up, with a pseudo random one, and counted again
+static void *concurrent_mixed_job(void *_job){
+    struct contention_job *job = _job;
+    long found = 0;
+    size_t i, count = job->end - job->start;
+
+    for (i = job->start; i < job->end; i++){
+        const char* other = job->words[job->start + (i * 7919) % count];
+
+        found += get_concurrent_hash_table(job->table, job->words[i]) != NULL;
+        found += get_concurrent_hash_table(job->table, other) != NULL;
+        add_concurrent_hash_table_n(job->table, job->words[i],
+                                    strlen(job->words[i]), 1);
+    }
+
+    return (void*) found;
+}
+
+
+static void *locked_add_job(void *_job){
+    struct contention_job *job = _job;
+    size_t i;
+
+    for (i = job->start; i < job->end; i++){
+        size_t len = strlen(job->words[i]);
+        hash_t hash = get_hash_n(job->words[i], len);
+
+        pthread_mutex_lock(job->lock);
+        void *v = get_hash_table_prehashed(job->locked_table, job->words[i],
+                                           len, hash);
+        insert_hash_table_prehashed(job->locked_table, job->words[i], len, hash,
+                                    (void*) (((long) v) + 1));
+        pthread_mutex_unlock(job->lock);
+    }
+
+    return NULL;
+}
+
+
+// Runs `f` on `threads` slices of the words, returns the seconds taken
+static double run_contention_jobs(void *(*f)(void *),
+                                  struct contention_job *job, size_t count,
+                                  int threads){
+    pthread_t workers[threads];
+    struct contention_job jobs[threads];
+    int t;
+
+    double start = now();
+    for (t = 0; t < threads; t++){
+        jobs[t] = *job;
+        jobs[t].start = (count * t) / threads;
+        jobs[t].end = (count * (t + 1)) / threads;
+
+        if (pthread_create(&workers[t], NULL, f, &jobs[t]) != 0){
+            workers[t] = pthread_self();
+            f(&jobs[t]);
+        }
+    }
+    for (t = 0; t < threads; t++){
+        if (!pthread_equal(workers[t], pthread_self())){
+            pthread_join(workers[t], NULL);
+        }
+    }
+
+    return now() - start;
+}
+
+
+struct count_check {
+    hash_table_t reference;
+    size_t mismatches;
+};
+
+
+static void check_count(const char* word, void* count, void* _check){
+    struct count_check* check = _check;
+
+    if (get_hash_table(check->reference, (char*) word) != count){
+        printf("count mismatch on '%s'\n", word);
+        check->mismatches++;
+    }
+}
+
+
+/*
+ * Word counting and lookups on the concurrent table at several thread
+ * counts, against a plain table behind a single lock.
+ */
+int bench_concurrent(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "concurrent <corpus> [threads...]\n");
+        return 1;
+    }
+
+    size_t count;
+    char** words = read_words(argv[0], &count);
+    if (words == NULL){
+        return 2;
+    }
+
+    int default_threads[] = { 1, 2, 4, 8, 16, 32 };
+    int thread_count = argc > 1 ? argc - 1 : 6;
+    size_t mismatches = 0;
+    int i;
+
+    for (i = 0; i < thread_count; i++){
+        int threads = argc > 1 ? atoi(argv[i + 1]) : default_threads[i];
+        if (threads < 1){
+            continue;
+        }
+
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+        struct contention_job job = {
+            words, 0, count,
+            create_concurrent_hash_table(), create_hash_table(), &lock
+        };
+
+        double add = run_contention_jobs(concurrent_add_job, &job, count, threads);
+        double read = run_contention_jobs(concurrent_read_job, &job, count, threads);
+        double mixed = run_contention_jobs(concurrent_mixed_job, &job, count,
+                                           threads);
+        double locked = run_contention_jobs(locked_add_job, &job, count, threads);
+        locked += run_contention_jobs(locked_add_job, &job, count, threads);
+
+        printf("concurrent threads=%-3i add %7.2f Mops/s  read %7.2f Mops/s  "
+               "mixed %7.2f Mops/s  | one lock: add %7.2f Mops/s\n",
+               threads, count / (add * 1e6),
+               (count * (double) CONCURRENT_READ_ROUNDS) / (read * 1e6),
+               (count * 3.0) / (mixed * 1e6),
+               (count * 2.0) / (locked * 1e6));
+
+        if (concurrent_hash_table_count(job.table) != hash_table_count(job.locked_table)){
+            printf("key count mismatch: %zu vs %zu\n",
+                   concurrent_hash_table_count(job.table),
+                   hash_table_count(job.locked_table));
+            mismatches++;
+        }
+        struct count_check check = { job.locked_table, 0 };
+        foreach_concurrent_hash_table(job.table, check_count, &check);
+        mismatches += check.mismatches;
+
+        free_concurrent_hash_table(job.table, NULL);
+        free_hash_table(job.locked_table, NULL);
+    }
+
+    free_words(words, count);
+
+    return mismatches == 0 ? 0 : 3;
+}
+
+
+/*
+ * Regression suite: every case is warmed up, then timed over several runs
+ * and reported as the median and 99th percentile (slow tail) run.
+ */
+struct suite_case {
+    const char* name;
+    const char* unit;
+    int rate;      /* unit is work per second, else nanoseconds per work */
+    double work;   /* per run, in the unit numerator */
+    double (*run)(void* data); /* one timed run, in seconds */
+    void* data;
+};
+
+
+static int compare_doubles(const void* a, const void* b){
+    double x = *(const double*) a, y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+
+static double suite_value(const struct suite_case* c, double seconds){
+    return c->rate ? c->work / seconds : (seconds * 1e9) / c->work;
+}
+
+
+// Allocations (with reallocs) and bytes of every module between snapshots
+static void alloc_totals(const alloc_snapshot_t* since,
+                         const alloc_snapshot_t* until,
+                         double* allocs, double* bytes){
+    int i;
+
+    *allocs = *bytes = 0;
+    for (i = 0; i < ALLOC_MODULE_COUNT; i++){
+        *allocs += (until->modules[i].allocs - since->modules[i].allocs)
+            + (until->modules[i].reallocs - since->modules[i].reallocs);
+        *bytes += until->modules[i].bytes - since->modules[i].bytes;
+    }
+}
+
+
+// Writes the human table to `report` and a JSON line to `json` if not NULL
+static void run_suite_case(const struct suite_case* c, int runs,
+                           FILE* report, FILE* json){
+    double seconds[runs];
+    alloc_snapshot_t alloc_since, alloc_until;
+    int i;
+
+    for (i = 0; i < SUITE_WARMUP_RUNS; i++){
+        c->run(c->data);
+    }
+    take_alloc_snapshot(&alloc_since);
+    for (i = 0; i < runs; i++){
+        seconds[i] = c->run(c->data);
+    }
+    take_alloc_snapshot(&alloc_until);
+    qsort(seconds, runs, sizeof(double), compare_doubles);
+
+    // Nearest rank percentiles, on run times so the tail is the slow side
+    double median = suite_value(c, seconds[(runs - 1) / 2]);
+    double p99 = suite_value(c, seconds[(99 * runs + 99) / 100 - 1]);
+    double best = suite_value(c, seconds[0]);
+
+    fprintf(report, "%-24s median %14.2f  p99 %14.2f  best %14.2f  %s",
+            c->name, median, p99, best, c->unit);
+
+    // Only built with ALLOC_STATS, a change means a new allocation path
+    double allocs = 0, bytes = 0;
+    if (alloc_stats_enabled()){
+        alloc_totals(&alloc_since, &alloc_until, &allocs, &bytes);
+        allocs /= runs;
+        bytes /= runs;
+        fprintf(report, "  allocs/run %.1f (%.0f B)", allocs, bytes);
+    }
+    fprintf(report, "\n");
+
+    if (json != NULL){
+        fprintf(json, "{\"name\": \"%s\", \"unit\": \"%s\", \"runs\": %i, "
+                "\"median\": %.4f, \"p99\": %.4f, \"best\": %.4f",
+                c->name, c->unit, runs, median, p99, best);
+        if (alloc_stats_enabled()){
+            fprintf(json, ", \"allocs_per_run\": %.1f, \"bytes_per_run\": %.0f",
+                    allocs, bytes);
+        }
+        fprintf(json, "}\n");
+    }
+}
+
+
+struct interpreter_case {
+    transform_model* programs[SUITE_RANDOM_PROGRAMS + 8];
+    int count;
+};
+
+
+// Bracket balanced random program, as the evolution starts from
+static char* random_program(unsigned long* state){
+    char* program = malloc(SUITE_PROGRAM_SIZE * 2 + 1);
+    int i, open = 0;
+
+    for (i = 0; i < SUITE_PROGRAM_SIZE;){
+        *state ^= *state << 13;
+        *state ^= *state >> 7;
+        *state ^= *state << 17;
+
+        char c = ".,+-<>[]"[*state % 8];
+        if (c == '['){
+            open++;
+        }
+        else if ((c == ']') && (open-- == 0)){
+            open = 0;
+            continue;
+        }
+        program[i++] = c;
+    }
+    for (; open > 0; open--){
+        program[i++] = ']';
+    }
+    program[i] = '\0';
+
+    return program;
+}
+
+
+static double interpreter_run(void* _data){
+    struct interpreter_case* data = _data;
+    int i;
+
+    double start = now();
+    for (i = 0; i < data->count; i++){
+        free(process(data->programs[i], SUITE_INPUT, NULL));
+    }
+
+    return now() - start;
+}
+
+
+struct score_case {
+    const language_model* model;
+    char* texts[SCORE_TEXTS];
+};
+
+
+static double score_run(void* _data){
+    struct score_case* data = _data;
+    unsigned long sink = 0;
+    int i, round;
+
+    double start = now();
+    for (round = 0; round < SUITE_SCORE_ROUNDS; round++){
+        for (i = 0; i < SCORE_TEXTS; i++){
+            sink += language_model_score(data->model, data->texts[i]);
+        }
+    }
+    double seconds = now() - start;
+
+    // Keep the scores alive
+    if (sink == 1){
+        printf(" ");
+    }
+
+    return seconds;
+}
+
+
+struct lookup_case {
+    hash_table_t table;
+    char** words;
+    size_t count;
+};
+
+
+static double lookup_run(void* _data){
+    struct lookup_case* data = _data;
+    size_t i, found = 0;
+
+    double start = now();
+    for (i = 0; i < data->count; i++){
+        found += get_hash_table(data->table, data->words[i]) != NULL;
+    }
+    double seconds = now() - start;
+
+    if (found == 1){
+        printf(" ");
+    }
+
+    return seconds;
+}
+
+
+static double build_run(void* fname){
+    double seconds;
+    long size;
+    language_model* model = timed_build(fname, 1, &seconds, &size);
+
+    free_language_model(model);
+
+    return seconds;
+}
+
+
+int bench_suite(int argc, char** argv){
+    if (argc < 1){
+        fprintf(stderr, "suite <corpus> [json output] [runs]\n");
+        return 1;
+    }
+
+    int runs = argc > 2 ? atoi(argv[2]) : SUITE_RUNS;
+    if (runs < 1){
+        fprintf(stderr, "Invalid run count %s\n", argv[2]);
+        return 1;
+    }
+
+    // JSON on stdout moves the table to stderr, so the JSON parses
+    FILE* json = NULL;
+    FILE* report = stdout;
+    if (argc > 1){
+        json = strcmp(argv[1], "-") == 0 ? stdout : fopen(argv[1], "w");
+        if (json == NULL){
+            perror(argv[1]);
+            return 2;
+        }
+        if (json == stdout){
+            report = stderr;
+        }
+    }
+
+    double seconds;
+    long corpus_size;
+    language_model* model = timed_build(argv[0], 1, &seconds, &corpus_size);
+    size_t count, i;
+    char** words = read_words(argv[0], &count);
+    if ((model == NULL) || (words == NULL)){
+        if (words != NULL){
+            free_words(words, count);
+        }
+        free_language_model(model);
+        if ((json != NULL) && (json != stdout)){
+            fclose(json);
+        }
+        return 2;
+    }
+
+    // Interpreter
+    {
+        struct interpreter_case data = { .count = 0 };
+        unsigned long state = 0x9e3779b97f4a7c15UL;
+        double cycles = 0;
+
+        for (i = 0; SUITE_PROGRAMS[i] != NULL; i++){
+            data.programs[data.count++] = transform_from_program(
+                (char*) SUITE_PROGRAMS[i]);
+        }
+        for (i = 0; i < SUITE_RANDOM_PROGRAMS; i++){
+            char* program = random_program(&state);
+            data.programs[data.count++] = transform_from_program(program);
+            free(program);
+        }
+
+        interpreter_run(&data);
+        for (i = 0; i < data.count; i++){
+            cycles += transform_model_cycles(data.programs[i]);
+        }
+
+        struct suite_case c = {
+            "interpreter", "cycles/s", 1, cycles, interpreter_run, &data
+        };
+        run_suite_case(&c, runs, report, json);
+
+        for (i = 0; i < data.count; i++){
+            free_transform_model(data.programs[i]);
+        }
+    }
+
+    // Scoring
+    for (i = 0; SCORE_LENGTHS[i] != 0; i++){
+        void (*generators[])(char*, int) = { words_text, random_text };
+        const char* kinds[] = { "words", "garbage" };
+        int length = SCORE_LENGTHS[i], kind, j;
+
+        for (kind = 0; kind < 2; kind++){
+            struct score_case data = { .model = model };
+            char name[64];
+
+            srand(length);
+            for (j = 0; j < SCORE_TEXTS; j++){
+                data.texts[j] = malloc(length + 1);
+                generators[kind](data.texts[j], length);
+            }
+
+            snprintf(name, sizeof(name), "score %s len=%i", kinds[kind], length);
+            struct suite_case c = {
+                name, "ns/B", 0, (double) SUITE_SCORE_ROUNDS * SCORE_TEXTS * length,
+                score_run, &data
+            };
+            run_suite_case(&c, runs, report, json);
+
+            for (j = 0; j < SCORE_TEXTS; j++){
+                free(data.texts[j]);
+            }
+        }
+    }
+
+    // Hash table
+    {
+        hash_table_t table = create_hash_table();
+        char** garbage = garbage_words(count);
+
+        for (i = 0; i < count; i++){
+            insert_hash_table(table, words[i], (void*) (i + 1));
+        }
+
+        struct lookup_case hits = { table, words, count };
+        struct lookup_case misses = { table, garbage, count };
+        struct suite_case cases[] = {
+            { "hash hit", "ns", 0, count, lookup_run, &hits },
+            { "hash miss", "ns", 0, count, lookup_run, &misses },
+        };
+        run_suite_case(&cases[0], runs, report, json);
+        run_suite_case(&cases[1], runs, report, json);
+
+        free_hash_table(table, NULL);
+        free_words(garbage, count);
+    }
+
+    // Model build
+    {
+        struct suite_case c = {
+            "build", "MB/s", 1, corpus_size / 1e6, build_run, argv[0]
+        };
+        run_suite_case(&c, runs, report, json);
+    }
+
+    if ((json != NULL) && (json != stdout)){
+        fclose(json);
+    }
+    free_words(words, count);
+    free_language_model(model);
+
+    return 0;
+}
+
+
+int main(int argc, char** argv){
+    if ((argc >= 2) && (strcmp(argv[1], "build") == 0)){
+        return bench_build(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "lifecycle") == 0)){
+        return bench_lifecycle(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "score") == 0)){
+        return bench_score(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "fixed") == 0)){
+        return bench_fixed(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "words") == 0)){
+        return bench_word_filter(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "automaton") == 0)){
+        return bench_automaton(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "concurrent") == 0)){
+        return bench_concurrent(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "hash") == 0)){
+        return bench_hash(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "hashes") == 0)){
+        return bench_hash_functions(argc - 2, &argv[2]);
+    }
+
+    if ((argc >= 2) && (strcmp(argv[1], "suite") == 0)){
+        return bench_suite(argc - 2, &argv[2]);
+    }
+
+    const char *name = argc > 0? argv[0] : "happy-bench";
+
+    printf("Model build: %s build <corpus> [threads...]\n", name);
+    printf("Start/stop:  %s lifecycle <corpus>\n", name);
+    printf("Scoring:     %s score <corpus> [high order KiB]\n", name);
+    printf("Fixed point: %s fixed <corpus>\n", name);
+    printf("Word filter: %s words <corpus> [rate...]\n", name);
+    printf("Word engine: %s automaton <corpus> [min word length]\n", name);
+    printf("Hash table:  %s hash <corpus>\n", name);
+    printf("Hashes:      %s hashes <corpus>\n", name);
+    printf("Regressions: %s suite <corpus> [json output|-] [runs]\n", name);
+    printf("Contention:  %s concurrent <corpus> [threads...]\n", name);
+
+    return 0;
+}
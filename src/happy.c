@@ -1,48 +1,294 @@
 #include "lang-model/model.h"
 #include "transform-model/model.h"
 #include "transform-model/controller.h"
+#include "ht/alloc_stats.h"
 #include <stdlib.h>
 #include <time.h>
 #include <assert.h>
 #include <string.h>
+#include <getopt.h>
+#include <math.h>
 
 const char* TEST_STR = "flag stars are made of weird stuff";
 const unsigned long max_same_score = 4000;
 const long max_time_without_bump  = 40000;
 
+// Every target decodes to TEST_STR
+struct evolve_target {
+    const char* name;
+    const char* text;
+};
+
+const struct evolve_target EVOLVE_TARGETS[] = {
+    { "cat", "flag stars are made of weird stuff" },
+    { "add-one", "ek`f\x1frs`qr\x1f`qd\x1fl`cd\x1fne\x1fvdhqc\x1frstee" },
+    { "base64", "ZmxhZyBzdGFycyBhcmUgbWFkZSBvZiB3ZWlyZCBzdHVmZg==" },
+    { "rot13", "synt fgnef ner znqr bs jrveq fghss" },
+    { NULL, NULL }
+};
+
+const long EVOLVE_SEEDS[] = { 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233 };
+#define EVOLVE_SEED_COUNT (sizeof(EVOLVE_SEEDS) / sizeof(EVOLVE_SEEDS[0]))
+#define EVOLVE_TARGET_COUNT \
+    (sizeof(EVOLVE_TARGETS) / sizeof(EVOLVE_TARGETS[0]) - 1)
+#define DEFAULT_BENCH_SEEDS 5
+#define DEFAULT_BENCH_CAP_SECONDS 60
+#define DEFAULT_SAMPLE_BYTES 4096
+#define DEFAULT_WINDOW_BYTES 256
+#define DEFAULT_HELD_OUT_WINDOWS 8
+#define WINDOW_PLACEMENT_TRIES 64
+#define STREAM_CYCLES_PER_BYTE 1000
+
+struct happy_options {
+    int threads;
+    size_t score_cache_kib;
+    size_t high_order_kib;
+    int fixed_point;
+    double word_filter_rate;
+    language_model_word_engine word_engine;
+    size_t min_word_length;
+    int metrics_fd;
+    evolve_metrics_format metrics_format;
+    int perf_interval;
+    int alloc_interval;
+    const char* profile_file;
+    size_t screen_prefix;
+    unsigned long screen_cycles;
+    double screen_promote;
+    double screen_margin;
+    unsigned long race_cycles;
+    int race_keep;
+    int audit_interval;
+    int steady_workers;
+    size_t sample_bytes;
+    size_t window_bytes;
+    int held_out_windows;
+};
+
+struct happy_options options = {
+    .threads = 1,
+    .score_cache_kib = 0,
+    .high_order_kib = 0,
+    .fixed_point = 0,
+    .word_filter_rate = 0,
+    .word_engine = LANGUAGE_MODEL_DELIMITED_WORDS,
+    .min_word_length = 2,
+    .metrics_fd = -1,
+    .metrics_format = EVOLVE_METRICS_JSON,
+    .perf_interval = 0,
+    .alloc_interval = 0,
+    .profile_file = NULL,
+    .screen_prefix = 0,
+    .screen_cycles = 0,  /* 0 and negatives keep the evolve defaults */
+    .screen_promote = -1,
+    .screen_margin = -1,
+    .race_cycles = 0,
+    .race_keep = 0,  /* keeps the evolve default */
+    .audit_interval = 0,
+    .steady_workers = 0,
+    .sample_bytes = DEFAULT_SAMPLE_BYTES,
+    .window_bytes = DEFAULT_WINDOW_BYTES,
+    .held_out_windows = DEFAULT_HELD_OUT_WINDOWS,
+};
+
+// Options without a short form
+enum {
+    OPT_SCREEN_CYCLES = 0x100,
+    OPT_SCREEN_PROMOTE,
+    OPT_SCREEN_MARGIN,
+    OPT_RACE_CYCLES,
+    OPT_RACE_KEEP,
+    OPT_AUDIT,
+    OPT_STEADY,
+    OPT_SAMPLE,
+    OPT_WINDOW,
+    OPT_HELD_OUT,
+};
+
+
+language_model* build_model(const char* fname, int* error){
+    FILE *f = fopen(fname, "rt");
+    if (f == NULL){
+        perror(fname);
+        *error = 1;
+        return NULL;
+    }
+
+    language_model_options model_options;
+    language_model_default_options(&model_options);
+    model_options.build_threads = options.threads;
+    model_options.high_order_bytes = options.high_order_kib * 1024;
+
+    language_model* model = build_language_model_with_options(f, &model_options);
+    if (model == NULL){
+        perror("Build language model");
+        *error = 2;
+    }
+
+    fclose(f);
+
+    return model;
+}
+
+
+/* Builds the model from a comma separated list of corpora. */
+language_model* load_model(const char* fnames, int* error){
+    char* names = strdup(fnames);
+    char* save = NULL;
+    char* fname;
+    language_model* model = NULL;
+
+    for (fname = strtok_r(names, ",", &save); fname != NULL;
+         fname = strtok_r(NULL, ",", &save)){
+
+        language_model* corpus_model = build_model(fname, error);
+        if (corpus_model == NULL){
+            free_language_model(model);
+            model = NULL;
+            break;
+        }
+
+        if (model == NULL){
+            model = corpus_model;
+        }
+        else {
+            int merged = merge_language_models(model, corpus_model) == 0;
+            free_language_model(corpus_model);
+
+            if (!merged){
+                perror(fname);
+                free_language_model(model);
+                model = NULL;
+                *error = 2;
+                break;
+            }
+        }
+    }
+
+    free(names);
+
+    if (model == NULL){
+        return NULL;
+    }
+
+    language_model_set_score_threads(model, options.threads);
+    language_model_set_fixed_point(model, options.fixed_point);
+
+    if (!language_model_set_word_engine(model, options.word_engine,
+                                        options.min_word_length)){
+        perror("Word automaton");
+    }
+
+    if (options.score_cache_kib > 0){
+        if (!language_model_enable_score_cache(model,
+                                               options.score_cache_kib * 1024)){
+            perror("Score cache");
+        }
+    }
+
+    if (options.word_filter_rate > 0){
+        if (!language_model_enable_word_filter(model, options.word_filter_rate)){
+            fprintf(stderr, "Word filter: the rate must be in (0, 1)\n");
+        }
+    }
+
+    assert(language_model_score(model, "flag star")
+           <
+           language_model_score(model, "flag stars are made of weird"));
+
+    return model;
+}
+
+
+void show_model_stats(const language_model* model){
+    score_cache_stats stats;
+
+    if (language_model_score_cache_stats(model, &stats)){
+        fprintf(stderr, "Score cache: %lu hits, %lu misses, %lu evictions "
+                "(%zu entries)\n",
+                stats.hits, stats.misses, stats.evictions, stats.entries);
+    }
+
+    word_filter_stats filter_stats;
+
+    if (language_model_word_filter_stats(model, &filter_stats)){
+        fprintf(stderr, "Word filter: %lu words, %lu rejected, %lu looked up "
+                "(%lu found)\n",
+                filter_stats.candidates, filter_stats.rejects,
+                filter_stats.candidates - filter_stats.rejects,
+                filter_stats.hits);
+    }
+}
+
+
+/* Controller state, reset before every evolution. */
+struct controller_state {
+    unsigned long last_score;
+    unsigned long last_score_times;
+    unsigned long last_bump_time;
+
+    int quiet;
+    double deadline;  /* monotonic seconds, 0 for none */
+    int found;
+};
+
+struct controller_state control;
+
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void reset_controller(int quiet, double deadline){
+    memset(&control, 0, sizeof(control));
+    control.quiet = quiet;
+    control.deadline = deadline;
+}
+
 
 int controller(int iteration, transform_model* transform,
                const char* better_output, unsigned long score){
 
-    static unsigned long last_score = 0;
-    static unsigned long last_score_times = 0;
-    static unsigned long last_bump_time = 0;
-
     if (strcmp(better_output, TEST_STR) == 0){
-        printf("Found on iteration %i!\n", iteration);
+        if (!control.quiet){
+            printf("Found on iteration %i!\n", iteration);
+        }
+        control.found = 1;
         return EVOLVE_DONE;
     }
 
-    if (score != last_score){
-        last_score_times = 0;
-        last_score = score;
+    if ((control.deadline > 0) && (now() > control.deadline)){
+        return EVOLVE_DONE;
     }
-    else if (last_score_times++ > max_same_score){
-        printf("#\x1b[1;40;96m Shake it! \x1b[0m\n");
-        last_score = 0;
-        last_score_times = 0;
-        last_bump_time = 0;
+
+    if (score != control.last_score){
+        control.last_score_times = 0;
+        control.last_score = score;
+    }
+    else if (control.last_score_times++ > max_same_score){
+        if (!control.quiet){
+            printf("#\x1b[1;40;96m Shake it! \x1b[0m\n");
+        }
+        control.last_score = 0;
+        control.last_score_times = 0;
+        control.last_bump_time = 0;
 
         return EVOLVE_SHAKE;
     }
 
-    if (last_bump_time++ > max_time_without_bump){
-        printf("#\x1b[1;40;91m BUMP!! \x1b[0m\n");
-        last_score = 0;
-        last_score_times = 0;
-        last_bump_time = 0;
+    if (control.last_bump_time++ > max_time_without_bump){
+        if (!control.quiet){
+            printf("#\x1b[1;40;91m BUMP!! \x1b[0m\n");
+        }
+        control.last_score = 0;
+        control.last_score_times = 0;
+        control.last_bump_time = 0;
 
-        return EVOLVE_SHAKE;
+        return EVOLVE_BUMP;
     }
 
 
@@ -50,10 +296,49 @@ int controller(int iteration, transform_model* transform,
 }
 
 
-void run(char *program, char *input){
+/* Returns a profile if one was asked for. */
+interpreter_profile* start_profile(){
+    if (options.profile_file == NULL){
+        return NULL;
+    }
+
+    interpreter_profile* profile = create_interpreter_profile();
+    if (profile == NULL){
+        perror("Interpreter profile");
+    }
+
+    return profile;
+}
+
+
+/* Shows the summary of the profile and dumps it to its file. */
+int finish_profile(interpreter_profile* profile){
+    if (profile == NULL){
+        return 0;
+    }
+
+    write_interpreter_profile(profile, stderr);
+
+    FILE* f = fopen(options.profile_file, "w");
+    if (f == NULL){
+        perror(options.profile_file);
+        free_interpreter_profile(profile);
+        return 4;
+    }
+
+    dump_interpreter_profile(profile, f);
+    fclose(f);
+    free_interpreter_profile(profile);
+
+    return 0;
+}
+
+
+int run(char *program, char *input){
     transform_model *transform = transform_from_program(program);
+    interpreter_profile* profile = start_profile();
 
-    char *output = process(transform, input, NULL);
+    char *output = process_profiled(transform, input, NULL, profile);
 
     show_transform_model(transform);
 
@@ -61,100 +346,889 @@ void run(char *program, char *input){
 
     free(output);
     free_transform_model(transform);
+
+    return finish_profile(profile);
 }
 
 
-int score(char *fname, char *text){
-    FILE *f = fopen(fname, "rt");
-    if (f == NULL){
-        perror(fname);
-        return 1;
+int score(char *fname, char **texts, int text_count){
+    int error = 0;
+    language_model* model = load_model(fname, &error);
+    if (model == NULL){
+        return error;
     }
 
-    language_model* model = build_language_model(f);
-    if (model == NULL){
-        perror("Build language model");
-        return 2;
+    size_t lengths[text_count];
+    unsigned long scores[text_count];
+    int i;
+
+    for (i = 0; i < text_count; i++){
+        lengths[i] = strlen(texts[i]);
     }
 
-    fclose(f);
+    alloc_snapshot_t alloc_since, alloc_until;
+    reset_alloc_peaks();
+    take_alloc_snapshot(&alloc_since);
 
-    assert(language_model_score(model, "flag star")
-           <
-           language_model_score(model, "flag stars are made of weird"));
+    language_model_score_batch(model, (const char**) texts, lengths,
+                               text_count, scores);
 
+    if (options.alloc_interval > 0){
+        if (alloc_stats_enabled()){
+            take_alloc_snapshot(&alloc_until);
+            report_alloc_stats(stderr, "score, per text", &alloc_since,
+                               &alloc_until, text_count);
+        }
+        else {
+            fprintf(stderr, "Allocation counts unavailable: "
+                    "built without ALLOC_STATS\n");
+        }
+    }
 
-    printf("%li\n", language_model_score(model, text));
+    for (i = 0; i < text_count; i++){
+        printf("%li\n", scores[i]);
+    }
 
+    show_model_stats(model);
     free_language_model(model);
 
     return 0;
 }
 
 
-int evolve(char* fname, char* text){
-    FILE *f = fopen(fname, "rt");
-    if (f == NULL){
-        perror(fname);
-        return 1;
+static void set_evaluation_options(evolve_options* evolve_opts){
+    evolve_opts->screen_prefix = options.screen_prefix;
+    evolve_opts->race_cycles = options.race_cycles;
+    evolve_opts->audit_interval = options.audit_interval;
+    evolve_opts->steady_workers = options.steady_workers;
+
+    if (options.race_keep > 0){
+        evolve_opts->race_keep = options.race_keep;
+    }
+    if (options.screen_cycles > 0){
+        evolve_opts->screen_cycles = options.screen_cycles;
+    }
+    if (options.screen_promote >= 0){
+        evolve_opts->screen_promote = options.screen_promote;
     }
+    if (options.screen_margin >= 0){
+        evolve_opts->screen_margin = options.screen_margin;
+    }
+}
 
-    language_model* model = build_language_model(f);
-    if (model == NULL){
-        perror("Build language model");
-        return 2;
+
+/* Complains about options the chosen evaluation can't honor. */
+static int check_evaluation_options(){
+    if ((options.screen_prefix > 0) && (options.race_cycles > 0)){
+        fprintf(stderr, "Screening and racing don't mix, drop -S or "
+                "--race-cycles\n");
+        return 1;
+    }
+    if ((options.race_cycles > 0) && (options.profile_file != NULL)){
+        fprintf(stderr, "Racing runs can't be profiled, drop -p or "
+                "--race-cycles\n");
+        return 1;
     }
+    if ((options.steady_workers > 0)
+        && ((options.screen_prefix > 0) || (options.race_cycles > 0)
+            || (options.audit_interval > 0) || (options.perf_interval > 0)
+            || (options.alloc_interval > 0) || (options.profile_file != NULL))){
+        fprintf(stderr, "Steady-state evolution evaluates in full without "
+                "reports, drop --steady or -S, --race-cycles, --audit, -P, "
+                "-A and -p\n");
+        return 1;
+    }
+    return 0;
+}
 
-    fclose(f);
 
-    assert(language_model_score(model, "flag star")
-           <
-           language_model_score(model, "flag stars are made of weird"));
+int evolve(char* fname, char* text){
+    int error = 0;
+    language_model* model = load_model(fname, &error);
+    if (model == NULL){
+        return error;
+    }
 
     long seed = time(NULL);
 
     printf("Seed: 0x%lX\n", seed);
     srand(seed);
-    transform_model* transform = evolve_transform(model, text, controller);
+    reset_controller(0, 0);
+
+    evolve_options evolve_opts;
+    evolve_default_options(&evolve_opts);
+    evolve_opts.metrics_fd = options.metrics_fd;
+    evolve_opts.metrics_format = options.metrics_format;
+    evolve_opts.perf_interval = options.perf_interval;
+    evolve_opts.alloc_interval = options.alloc_interval;
+    evolve_opts.profile = start_profile();
+    set_evaluation_options(&evolve_opts);
+
+    transform_model* transform = evolve_transform_with_options(
+        model, text, controller, &evolve_opts, NULL);
     if (transform == NULL){
         perror("Evolve transform");
         return 3;
     }
 
     show_transform_model(transform);
+    show_model_stats(model);
     free_language_model(model);
     free_transform_model(transform);
 
+    return finish_profile(evolve_opts.profile);
+}
+
+/*
+ * Reads a window of the file, '\0' ended. Fails on short reads and on
+ * windows with NUL bytes, which transforms can't be evolved on.
+ */
+static int read_window(FILE* f, long offset, size_t length, char* window){
+    if ((fseek(f, offset, SEEK_SET) != 0)
+        || (fread(window, 1, length, f) != length)){
+        return 0;
+    }
+    window[length] = '\0';
+
+    return strlen(window) == length;
+}
+
+
+// Random offsets of windows, one in each of `count` equal slices of the file
+static void place_windows(long size, size_t length, int count, long offsets[]){
+    long slice = size / count;
+    int i;
+
+    for (i = 0; i < count; i++){
+        long room = slice - (long) length;
+
+        offsets[i] = i * slice + (room > 0 ? rand() % (room + 1) : 0);
+        if (offsets[i] + (long) length > size){
+            offsets[i] = size - length;
+        }
+    }
+}
+
+
+static int overlaps(long offset, size_t length, const long offsets[],
+                    int count){
+    int i;
+
+    for (i = 0; i < count; i++){
+        if ((offset < offsets[i] + (long) length)
+            && (offsets[i] < offset + (long) length)){
+            return 1;
+        }
+    }
+
     return 0;
 }
 
 
-int main(int argc, char **argv){
+/*
+ * Reads a window at a random offset, away from the `placed` ones when the
+ * tries allow. Returns its offset, or -1 if every try was unreadable or
+ * had NUL bytes.
+ */
+static long place_readable_window(FILE* f, long size, size_t length,
+                                  const long placed[], int count,
+                                  char* window, int* overlapping){
+    long fallback = -1;
+    int tries;
 
-    if ((argc == 4) && (strcmp(argv[1], "run") == 0)){
-        run(argv[2], argv[3]);
-        return 0;
+    for (tries = 0; tries < WINDOW_PLACEMENT_TRIES; tries++){
+        long offset;
+
+        place_windows(size, length, 1, &offset);
+        int overlap = overlaps(offset, length, placed, count);
+        if ((overlap && (fallback >= 0))
+            || (!read_window(f, offset, length, window))){
+            continue;
+        }
+        if (!overlap){
+            *overlapping = 0;
+            return offset;
+        }
+        fallback = offset;
     }
 
-    if ((argc >= 4) && (strcmp(argv[1], "score") == 0)){
-        int i;
-        for (i = 3; i < argc; i++){
-            int ret = score(argv[2], argv[i]);
-            if (ret != 0){
-                return ret;
+    // Later tries may have overwritten it
+    if ((fallback < 0) || (!read_window(f, fallback, length, window))){
+        return -1;
+    }
+    *overlapping = 1;
+    return fallback;
+}
+
+
+/*
+ * Scores of a transform on windows of the same length, which scores of
+ * different lengths can't be compared with: the penalties grow with it.
+ */
+struct window_scores {
+    int count;
+    double sum;
+    long min;
+    unsigned long cycles;
+};
+
+
+static long score_window(transform_model* transform, const char* window,
+                         const language_model* model,
+                         struct window_scores* scores){
+
+    free(process(transform, window, model));
+    long score = transform_model_score(transform);
+
+    if ((scores->count == 0) || (score < scores->min)){
+        scores->min = score;
+    }
+    scores->sum += score;
+    scores->cycles += transform_model_cycles(transform);
+    scores->count++;
+
+    return score;
+}
+
+
+/*
+ * Evolution on inputs of any size: the transform evolves on a sample of
+ * windows spread over the file, is checked on windows it didn't see and
+ * then streamed over the whole file.
+ */
+int evolve_sampled(char* fname, char* input_name, double seconds,
+                   char* output_name){
+
+    FILE* input = fopen(input_name, "rb");
+    if (input == NULL){
+        perror(input_name);
+        return 1;
+    }
+
+    fseek(input, 0, SEEK_END);
+    long size = ftell(input);
+    size_t length = options.window_bytes;
+    if ((size <= 0) || (length < 1) || (seconds <= 0)){
+        fprintf(stderr, "Needs a non-empty input, windows and a time budget\n");
+        fclose(input);
+        return 1;
+    }
+    if ((long) length > size){
+        length = size;
+    }
+
+    int count = options.sample_bytes / length;
+    if (count < 1){
+        count = 1;
+    }
+    if (count > size / (long) length){
+        count = size / length;
+    }
+
+    long seed = time(NULL);
+    fprintf(stderr, "Seed: 0x%lX\n", seed);
+    srand(seed);
+
+    // Training sample, re-placing the windows that can't be read or have
+    // NUL bytes
+    long offsets[count];
+    char* sample = malloc(count * length + 1);
+    int placed = 0, skipped = 0;
+    int i;
+
+    place_windows(size, length, count, offsets);
+    for (i = 0; i < count; i++){
+        char* window = &sample[placed * length];
+        int overlapping;
+
+        if (read_window(input, offsets[i], length, window)){
+            offsets[placed++] = offsets[i];
+            continue;
+        }
+
+        long offset = place_readable_window(input, size, length, offsets,
+                                            placed, window, &overlapping);
+        if (offset < 0){
+            skipped++;
+            continue;
+        }
+        offsets[placed++] = offset;
+    }
+    if (placed == 0){
+        fprintf(stderr, "%s: no readable window without NUL bytes\n",
+                input_name);
+        free(sample);
+        fclose(input);
+        return 1;
+    }
+    count = placed;
+    fprintf(stderr, "Sample: %i windows of %zu bytes out of %li", count,
+            length, size);
+    if (skipped > 0){
+        fprintf(stderr, ", %i skipped (unreadable or with NUL bytes)",
+                skipped);
+    }
+    fprintf(stderr, "\n");
+
+    int error = 0;
+    language_model* model = load_model(fname, &error);
+    if (model == NULL){
+        free(sample);
+        fclose(input);
+        return error;
+    }
+
+    int quiet = strcmp(output_name, "-") == 0;
+    reset_controller(quiet, now() + seconds);
+
+    evolve_options evolve_opts;
+    evolve_default_options(&evolve_opts);
+    if (quiet){
+        evolve_opts.show_interval = 0;
+    }
+    evolve_opts.metrics_fd = options.metrics_fd;
+    evolve_opts.metrics_format = options.metrics_format;
+    evolve_opts.perf_interval = options.perf_interval;
+    evolve_opts.alloc_interval = options.alloc_interval;
+    set_evaluation_options(&evolve_opts);
+
+    transform_model* transform = evolve_transform_with_options(
+        model, sample, controller, &evolve_opts, NULL);
+    if (transform == NULL){
+        perror("Evolve transform");
+        free(sample);
+        fclose(input);
+        return 3;
+    }
+
+    // Training windows one by one, to compare with the held out ones
+    struct window_scores training = { .count = 0 };
+    char* window = malloc(length + 1);
+    for (i = 0; i < count; i++){
+        memcpy(window, &sample[i * length], length);
+        window[length] = '\0';
+        score_window(transform, window, model, &training);
+    }
+    fprintf(stderr, "Training: %.0f per window on average (min %li)\n",
+            training.sum / training.count, training.min);
+
+    // Held out windows, away from the sample when the file allows
+    struct window_scores held_out = { .count = 0 };
+    skipped = 0;
+    for (i = 0; i < options.held_out_windows; i++){
+        int overlapping;
+        long offset = place_readable_window(input, size, length, offsets,
+                                            count, window, &overlapping);
+        if (offset < 0){
+            skipped++;
+            continue;
+        }
+
+        long score = score_window(transform, window, model, &held_out);
+        fprintf(stderr, "Held out at %li%s: %li\n", offset,
+                overlapping ? " (overlaps the sample)" : "", score);
+    }
+    free(window);
+
+    if (skipped > 0){
+        fprintf(stderr, "Held out: %i of %i windows skipped (unreadable or "
+                "with NUL bytes)\n", skipped, options.held_out_windows);
+    }
+    if (held_out.count > 0){
+        double training_mean = training.sum / training.count;
+        double held_out_mean = held_out.sum / held_out.count;
+
+        fprintf(stderr, "Held out: %.0f per window on average (min %li), "
+                "%.0f%% of training\n", held_out_mean, held_out.min,
+                training_mean != 0 ? 100 * held_out_mean / training_mean : 0);
+    }
+
+    // Whole input, with twice the cycles per byte the sample took
+    FILE* output = quiet ? stdout : fopen(output_name, "wb");
+    if (output == NULL){
+        perror(output_name);
+        error = 1;
+    }
+    else {
+        stream_stats stats;
+        double start = now();
+
+        rewind(input);
+        error = stream_transform(transform, input, output,
+                                 2 * training.cycles / (count * length) + 1,
+                                 &stats) != 0;
+        if (error){
+            perror(output_name);
+        }
+        if (!quiet){
+            fclose(output);
+        }
+
+        fprintf(stderr, "Streamed: %lu bytes in, %lu out, %lu cycles%s%s "
+                "(%.1f MB/s)\n", stats.bytes_in, stats.bytes_out, stats.cycles,
+                stats.crashed ? ", crashed" : "", stats.capped ? ", capped" : "",
+                stats.bytes_in / (now() - start) / 1e6);
+    }
+
+    // Not to mix with the output on stdout
+    write_transform_model(transform, quiet ? stderr : stdout);
+    free_transform_model(transform);
+    free_language_model(model);
+    free(sample);
+    fclose(input);
+
+    return error;
+}
+
+
+// Runs a program over a file, or more input than the command line takes
+int stream(char* program, char* input_name, char* output_name){
+    FILE* input = fopen(input_name, "rb");
+    if (input == NULL){
+        perror(input_name);
+        return 1;
+    }
+
+    FILE* output = output_name != NULL ? fopen(output_name, "wb") : stdout;
+    if (output == NULL){
+        perror(output_name);
+        fclose(input);
+        return 1;
+    }
+
+    transform_model* transform = transform_from_program(program);
+    stream_stats stats;
+    int error = stream_transform(transform, input, output,
+                                 STREAM_CYCLES_PER_BYTE, &stats) != 0;
+    if (error){
+        perror("Stream");
+    }
+
+    fprintf(stderr, "Streamed: %lu bytes in, %lu out, %lu cycles%s%s\n",
+            stats.bytes_in, stats.bytes_out, stats.cycles,
+            stats.crashed ? ", crashed" : "", stats.capped ? ", capped" : "");
+
+    free_transform_model(transform);
+    if (output != stdout){
+        fclose(output);
+    }
+    fclose(input);
+
+    return error;
+}
+
+
+struct evolve_result {
+    long seed;
+    int solved;
+    unsigned long generations;
+    unsigned long evaluations;
+    unsigned long screenings;
+    double seconds;
+};
+
+
+static int compare_doubles(const void* a, const void* b){
+    double x = *(const double*) a, y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+
+// Nearest rank summary of the solved runs, null when none solved
+static void print_distribution(const char* name, const double* values,
+                               int count){
+    if (count == 0){
+        printf("\"%s\": null", name);
+        return;
+    }
+
+    double sorted[count];
+    memcpy(sorted, values, sizeof(double) * count);
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    printf("\"%s\": {\"min\": %g, \"median\": %g, \"p90\": %g, \"max\": %g}",
+           name, sorted[0], sorted[(count - 1) / 2],
+           sorted[(int) ceil(0.9 * count) - 1], sorted[count - 1]);
+}
+
+
+static void print_target_results(const struct evolve_target* target,
+                                 const struct evolve_result* results,
+                                 int runs){
+    double generations[runs], seconds[runs];
+    double evaluations = 0, total_seconds = 0;
+    int i, solved = 0;
+
+    printf("    {\"target\": \"%s\", \"runs\": [\n", target->name);
+    for (i = 0; i < runs; i++){
+        printf("        {\"seed\": %li, \"solved\": %s, \"generations\": %lu, "
+               "\"evaluations\": %lu, \"screenings\": %lu, "
+               "\"seconds\": %.3f}%s\n",
+               results[i].seed, results[i].solved ? "true" : "false",
+               results[i].generations, results[i].evaluations,
+               results[i].screenings, results[i].seconds, i + 1 < runs ? "," : "");
+
+        if (results[i].solved){
+            generations[solved] = results[i].generations;
+            seconds[solved++] = results[i].seconds;
+        }
+        evaluations += results[i].evaluations;
+        total_seconds += results[i].seconds;
+    }
+
+    printf("     ], \"success_rate\": %.3f, ", (double) solved / runs);
+    print_distribution("generations", generations, solved);
+    printf(", ");
+    print_distribution("seconds", seconds, solved);
+    printf(", \"evaluations_per_second\": %.1f}",
+           total_seconds > 0 ? evaluations / total_seconds : 0);
+}
+
+
+/*
+ * Time to solution of the evolve workloads, over fixed seeds and with a
+ * wall clock cap per run. Progress goes to stderr, results to stdout as
+ * JSON.
+ */
+int bench_evolve(int argc, char** argv){
+    double cap = argc > 1 ? atof(argv[1]) : DEFAULT_BENCH_CAP_SECONDS;
+    int seeds = argc > 2 ? atoi(argv[2]) : DEFAULT_BENCH_SEEDS;
+    int target_count = argc > 3 ? argc - 3 : 0;
+    const struct evolve_target* targets[EVOLVE_TARGET_COUNT];
+    int i, j;
+
+    if ((cap <= 0) || (seeds < 1) || (seeds > (int) EVOLVE_SEED_COUNT)){
+        fprintf(stderr, "The cap must be positive and there are 1 to %zu seeds\n",
+                EVOLVE_SEED_COUNT);
+        return 1;
+    }
+
+    if (target_count > (int) EVOLVE_TARGET_COUNT){
+        fprintf(stderr, "There are only %zu targets\n", EVOLVE_TARGET_COUNT);
+        return 1;
+    }
+
+    if ((options.metrics_fd >= 0) || (options.perf_interval > 0)
+        || (options.alloc_interval > 0) || (options.profile_file != NULL)){
+        fprintf(stderr, "bench-evolve only reports times to solution, drop "
+                "-M, -P, -A and -p\n");
+        return 1;
+    }
+
+    if (target_count == 0){
+        for (; EVOLVE_TARGETS[target_count].name != NULL; target_count++){
+            targets[target_count] = &EVOLVE_TARGETS[target_count];
+        }
+    }
+    else {
+        for (i = 0; i < target_count; i++){
+            targets[i] = NULL;
+            for (j = 0; EVOLVE_TARGETS[j].name != NULL; j++){
+                if (strcmp(argv[3 + i], EVOLVE_TARGETS[j].name) == 0){
+                    targets[i] = &EVOLVE_TARGETS[j];
+                }
+            }
+            if (targets[i] == NULL){
+                fprintf(stderr, "Unknown target '%s'\n", argv[3 + i]);
+                return 1;
             }
         }
+    }
 
-        return 0;
+    int error = 0;
+    language_model* model = load_model(argv[0], &error);
+    if (model == NULL){
+        return error;
+    }
+
+    evolve_options evolve_opts;
+    evolve_default_options(&evolve_opts);
+    evolve_opts.show_interval = 0;
+    set_evaluation_options(&evolve_opts);
+
+    printf("{\"cap_seconds\": %g, \"targets\": [\n", cap);
+
+    for (i = 0; i < target_count; i++){
+        struct evolve_result results[seeds];
+
+        for (j = 0; j < seeds; j++){
+            evolve_stats stats;
+            double start = now();
+
+            srand(EVOLVE_SEEDS[j]);
+            reset_controller(1, start + cap);
+            transform_model* transform = evolve_transform_with_options(
+                model, targets[i]->text, controller, &evolve_opts, &stats);
+            if (transform == NULL){
+                perror("Evolve transform");
+                printf("    {\"target\": \"%s\", \"error\": \"evolve failed\"}"
+                       "\n]}\n", targets[i]->name);
+                free_language_model(model);
+                return 3;
+            }
+            free_transform_model(transform);
+
+            results[j].seed = EVOLVE_SEEDS[j];
+            results[j].solved = control.found;
+            results[j].generations = stats.generations;
+            results[j].evaluations = stats.evaluations;
+            results[j].screenings = stats.screenings;
+            results[j].seconds = now() - start;
+
+            fprintf(stderr, "%-8s seed %3li  %-8s %8lu generations %8.2f s\n",
+                    targets[i]->name, results[j].seed,
+                    results[j].solved ? "solved" : "capped",
+                    results[j].generations, results[j].seconds);
+        }
+
+        print_target_results(targets[i], results, seeds);
+        printf("%s\n", i + 1 < target_count ? "," : "");
+    }
+
+    printf("]}\n");
+
+    show_model_stats(model);
+    free_language_model(model);
+
+    return 0;
+}
+
+
+int main(int argc, char **argv){
+    const char *name = argc > 0? argv[0] : "happy";
+    const struct option long_options[] = {
+        {"threads", required_argument, NULL, 'j'},
+        {"score-cache", required_argument, NULL, 'c'},
+        {"high-order", required_argument, NULL, 'H'},
+        {"fixed-point", no_argument, NULL, 'F'},
+        {"word-filter", required_argument, NULL, 'W'},
+        {"word-engine", required_argument, NULL, 'w'},
+        {"min-word-length", required_argument, NULL, 'm'},
+        {"metrics-fd", required_argument, NULL, 'M'},
+        {"metrics-format", required_argument, NULL, 'f'},
+        {"perf", required_argument, NULL, 'P'},
+        {"profile", required_argument, NULL, 'p'},
+        {"alloc-stats", required_argument, NULL, 'A'},
+        {"screen-prefix", required_argument, NULL, 'S'},
+        {"screen-cycles", required_argument, NULL, OPT_SCREEN_CYCLES},
+        {"screen-promote", required_argument, NULL, OPT_SCREEN_PROMOTE},
+        {"screen-margin", required_argument, NULL, OPT_SCREEN_MARGIN},
+        {"race-cycles", required_argument, NULL, OPT_RACE_CYCLES},
+        {"race-keep", required_argument, NULL, OPT_RACE_KEEP},
+        {"audit", required_argument, NULL, OPT_AUDIT},
+        {"steady", required_argument, NULL, OPT_STEADY},
+        {"sample", required_argument, NULL, OPT_SAMPLE},
+        {"window", required_argument, NULL, OPT_WINDOW},
+        {"held-out", required_argument, NULL, OPT_HELD_OUT},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "+j:c:H:FW:w:m:M:f:P:p:A:S:", long_options, NULL)) != -1){
+        switch (opt){
+        case 'j':
+            options.threads = atoi(optarg);
+            if (options.threads < 1){
+                fprintf(stderr, "The thread count must be at least 1\n");
+                return 1;
+            }
+            break;
+
+        case 'c':
+            options.score_cache_kib = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'H':
+            options.high_order_kib = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'F':
+            options.fixed_point = 1;
+            break;
+
+        case 'W':
+            options.word_filter_rate = atof(optarg);
+            break;
+
+        case 'w':
+            if (strcmp(optarg, "automaton") == 0){
+                options.word_engine = LANGUAGE_MODEL_AUTOMATON_WORDS;
+            }
+            else if (strcmp(optarg, "delimited") == 0){
+                options.word_engine = LANGUAGE_MODEL_DELIMITED_WORDS;
+            }
+            else {
+                fprintf(stderr, "Unknown word engine '%s'\n", optarg);
+                return 1;
+            }
+            break;
+
+        case 'm':
+            options.min_word_length = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'M':
+            options.metrics_fd = atoi(optarg);
+            break;
+
+        case 'P':
+            options.perf_interval = atoi(optarg);
+            break;
+
+        case 'p':
+            options.profile_file = optarg;
+            break;
+
+        case 'A':
+            options.alloc_interval = atoi(optarg);
+            break;
+
+        case 'S':
+            options.screen_prefix = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_SCREEN_CYCLES:
+            options.screen_cycles = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_SCREEN_PROMOTE:
+            options.screen_promote = atof(optarg);
+            break;
+
+        case OPT_SCREEN_MARGIN:
+            options.screen_margin = atof(optarg);
+            break;
+
+        case OPT_RACE_CYCLES:
+            options.race_cycles = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_RACE_KEEP:
+            options.race_keep = atoi(optarg);
+            break;
+
+        case OPT_AUDIT:
+            options.audit_interval = atoi(optarg);
+            break;
+
+        case OPT_STEADY:
+            options.steady_workers = atoi(optarg);
+            break;
+
+        case OPT_SAMPLE:
+            options.sample_bytes = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_WINDOW:
+            options.window_bytes = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_HELD_OUT:
+            options.held_out_windows = atoi(optarg);
+            break;
+
+        case 'f':
+            if (strcmp(optarg, "json") == 0){
+                options.metrics_format = EVOLVE_METRICS_JSON;
+            }
+            else if (strcmp(optarg, "csv") == 0){
+                options.metrics_format = EVOLVE_METRICS_CSV;
+            }
+            else {
+                fprintf(stderr, "Unknown metrics format '%s'\n", optarg);
+                return 1;
+            }
+            break;
+
+        default:
+            return 1;
+        }
+    }
+
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if (check_evaluation_options() != 0){
+        return 1;
+    }
+
+    if ((argc == 4) && (strcmp(argv[1], "run") == 0)){
+        return run(argv[2], argv[3]);
+    }
+
+    if ((argc >= 4) && (strcmp(argv[1], "score") == 0)){
+        return score(argv[2], &argv[3], argc - 3);
     }
 
-    if ((argc == 4) || (strcmp(argv[1], "evolve") == 0)){
+    if ((argc == 4) && (strcmp(argv[1], "evolve") == 0)){
         return evolve(argv[2], argv[3]);
     }
 
-    printf("Evolve program: %s evolve <file> <text>\n", argc > 0? argv[0] : "happy");
-    printf("Score output:   %s score  <file> <text> [...]\n", argc > 0? argv[0] : "happy");
-    printf("Run program:    %s run    <file> <input>\n", argc > 0? argv[0] : "happy");
+    if ((argc >= 3) && (strcmp(argv[1], "bench-evolve") == 0)){
+        return bench_evolve(argc - 2, &argv[2]);
+    }
+
+    if ((argc == 6) && (strcmp(argv[1], "evolve-sampled") == 0)){
+        return evolve_sampled(argv[2], argv[3], atof(argv[4]), argv[5]);
+    }
+
+    if (((argc == 4) || (argc == 5)) && (strcmp(argv[1], "stream") == 0)){
+        return stream(argv[2], argv[3], argc == 5 ? argv[4] : NULL);
+    }
+
+    printf("Evolve program: %s [options] evolve <file>[,<file>...] <text>\n", name);
+    printf("Time to solve:  %s [options] bench-evolve <file>[,<file>...] "
+           "[cap seconds] [seeds] [target...]\n", name);
+    printf("Score output:   %s [options] score  <file>[,<file>...] <text> [...]\n", name);
+    printf("Large input:    %s [options] evolve-sampled <file>[,<file>...] "
+           "<input file> <seconds> <output file|->\n", name);
+    printf("Run program:    %s [options] run <program> <input>\n", name);
+    printf("Stream program: %s [options] stream <program> <input file> "
+           "[output file]\n", name);
+    printf("\nOptions:\n");
+    printf("  -j, --threads <n>          Build and score with <n> threads\n");
+    printf("  -c, --score-cache <KiB>    Memoise scores by output\n");
+    printf("  -H, --high-order <KiB>     Score 4 and 5-grams too\n");
+    printf("  -F, --fixed-point          Score with integer arithmetic\n");
+    printf("  -W, --word-filter <rate>   Pre-check words with a bloom filter of\n"
+           "                             the given false positive rate\n");
+    printf("  -w, --word-engine <engine> 'delimited' (alphabetic runs, default)\n"
+           "                             or 'automaton' (any dictionary word)\n");
+    printf("  -m, --min-word-length <n>  Shortest word the automaton credits (2)\n");
+    printf("  -M, --metrics-fd <fd>      Write per generation metrics of evolve\n"
+           "                             to the descriptor (e.g. 3 with 3>file)\n");
+    printf("  -f, --metrics-format <fmt> 'json' (a line per generation, default)\n"
+           "                             or 'csv'\n");
+    printf("  -P, --perf <n>             Report hardware counters of evolve\n"
+           "                             phases every <n> generations\n");
+    printf("  -p, --profile <file>       Profile the interpreter runs of run or\n"
+           "                             evolve, dump the profile as JSON\n");
+    printf("  -A, --alloc-stats <n>      Report the allocations of every module\n"
+           "                             every <n> evolve generations, or per\n"
+           "                             text for score (make ALLOC_STATS=1)\n");
+    printf("  -S, --screen-prefix <n>    Evolve screening everybody on the first\n"
+           "                             <n> bytes of the text, and evaluating\n"
+           "                             in full only the promoted\n");
+    printf("      --screen-cycles <n>    Cycle budget of the screening (20000)\n");
+    printf("      --screen-promote <f>   Promoted share of the population (0.25)\n");
+    printf("      --screen-margin <f>    Also promote who screens at least <f>\n"
+           "                             times the best, 0 for none (0.9)\n");
+    printf("      --race-cycles <n>      Evolve racing everybody <n> cycles, then\n"
+           "                             the better half twice as long... (0)\n");
+    printf("      --race-keep <n>        Racers left to run in full (16)\n");
+    printf("      --audit <n>            Evaluate everybody in full every <n>\n"
+           "                             generations, reporting in the metrics\n"
+           "                             the work saved and the ranking changes\n");
+    printf("      --steady <n>           Evolve steady-state, evaluating offspring\n"
+           "                             on <n> threads as they are bred, in\n"
+           "                             full and without -P, -A or -p\n");
+    printf("      --sample <bytes>       Sample evolve-sampled evolves on (%i)\n",
+           DEFAULT_SAMPLE_BYTES);
+    printf("      --window <bytes>       Size of the sample windows (%i)\n",
+           DEFAULT_WINDOW_BYTES);
+    printf("      --held-out <n>         Windows the winner is checked on (%i)\n",
+           DEFAULT_HELD_OUT_WINDOWS);
 
     return 0;
 
@@ -0,0 +1,524 @@
+#ifndef AHO_CORASICK_C
+#define AHO_CORASICK_C
+
+#include "aho_corasick.h"
+#include <assert.h>
+#include <string.h>
+
+#define ALLOC_MODULE ALLOC_AHO_CORASICK
+#include "alloc_stats.h"
+
+/**
+ * @file aho_corasick.c
+ *
+ * @brief Aho-Corasick automaton implementation.
+ *
+ * Bytes are mapped to codes 1..alphabet, code 0 being the bytes that no
+ * key uses (which always lead back to the start). The child of state s
+ * through code c is the cell t = base[s] + c, valid when check[t] == s.
+ *
+ * The failure links point to the longest proper suffix that is also in
+ * the trie, `match` keeps the length of the longest key among the suffixes
+ * of each state. Once built, the array is trimmed after the last state.
+ *
+ */
+
+#define AC_FREE -1
+#define AC_INITIAL_CELLS 1024
+
+/**
+ * Double array cell, everything a step reads about a state is in the
+ * same cache line.
+ *
+ */
+typedef struct {
+    int32_t base;
+    int32_t check;
+    int32_t fail;
+    int32_t match;
+} ac_cell_t;
+
+
+/**
+ * Aho-Corasick automaton structure.
+ *
+ */
+struct aho_corasick{
+    uint8_t codes[256];
+    int alphabet;
+
+    size_t size;
+    size_t states;
+    ac_cell_t *cells;
+
+    /* Building only, doubly linked list of the free cells */
+    int32_t *free_next;
+    int32_t *free_prev;
+    int32_t free_head;
+    int32_t free_tail;
+};
+
+
+/**
+ * Key being compiled.
+ *
+ */
+typedef struct {
+    const char *key;
+    size_t len;
+} ac_key_t;
+
+
+/**
+ * Description: Orders keys bytewise, prefixes first.
+ *
+ */
+static int _compare_keys(const void *a, const void *b){
+    const ac_key_t *key1 = a, *key2 = b;
+    size_t len = key1->len < key2->len ? key1->len : key2->len;
+    int cmp = memcmp(key1->key, key2->key, len);
+
+    if (cmp != 0){
+        return cmp;
+    }
+
+    return (key1->len > key2->len) - (key1->len < key2->len);
+}
+
+
+/**
+ * Description: Makes sure the double array has a given cell.
+ *
+ * @return 1 on success, 0 if out of memory.
+ *
+ */
+static int _reserve_cells(aho_corasick_t *automaton, size_t cell){
+    if (cell < automaton->size){
+        return 1;
+    }
+
+    size_t size = automaton->size > 0 ? automaton->size : AC_INITIAL_CELLS;
+    while (size <= cell){
+        size *= 2;
+    }
+
+    ac_cell_t *cells = realloc(automaton->cells, sizeof(ac_cell_t) * size);
+    if (cells == NULL){
+        return 0;
+    }
+    automaton->cells = cells;
+
+    int32_t *free_next = realloc(automaton->free_next, sizeof(int32_t) * size);
+    if (free_next == NULL){
+        return 0;
+    }
+    automaton->free_next = free_next;
+
+    int32_t *free_prev = realloc(automaton->free_prev, sizeof(int32_t) * size);
+    if (free_prev == NULL){
+        return 0;
+    }
+    automaton->free_prev = free_prev;
+
+    // The new cells go to the end of the free list
+    size_t i;
+    for (i = automaton->size; i < size; i++){
+        cells[i].base = 0;
+        cells[i].check = AC_FREE;
+        cells[i].fail = AHO_CORASICK_START;
+        cells[i].match = 0;
+
+        free_prev[i] = automaton->free_tail;
+        free_next[i] = -1;
+        if (automaton->free_tail >= 0){
+            free_next[automaton->free_tail] = i;
+        }
+        else {
+            automaton->free_head = i;
+        }
+        automaton->free_tail = i;
+    }
+    automaton->size = size;
+
+    return 1;
+}
+
+
+/**
+ * Description: Marks a free cell as used by a child of `parent`.
+ *
+ */
+static void _take_cell(aho_corasick_t *automaton, int32_t cell,
+                       int32_t parent){
+
+    int32_t prev = automaton->free_prev[cell];
+    int32_t next = automaton->free_next[cell];
+
+    if (prev >= 0){
+        automaton->free_next[prev] = next;
+    }
+    else {
+        automaton->free_head = next;
+    }
+
+    if (next >= 0){
+        automaton->free_prev[next] = prev;
+    }
+    else {
+        automaton->free_tail = prev;
+    }
+
+    automaton->cells[cell].check = parent;
+}
+
+
+/**
+ * Description: Finds a base where all the given child codes land on free
+ * cells.
+ *
+ * @return The base or -1 if out of memory.
+ *
+ */
+static int32_t _find_base(aho_corasick_t *automaton, const uint8_t *codes,
+                          int count){
+    int32_t pos = automaton->free_head;
+    int i;
+
+    for (;;){
+        // Out of free cells, grow the array
+        if (pos < 0){
+            pos = automaton->size;
+        }
+        if (!_reserve_cells(automaton, pos + automaton->alphabet)){
+            return -1;
+        }
+
+        // The first child must not land below the start
+        if (pos > codes[0]){
+            int32_t base = pos - codes[0];
+
+            for (i = 1; i < count; i++){
+                if (automaton->cells[base + codes[i]].check != AC_FREE){
+                    break;
+                }
+            }
+
+            if (i == count){
+                return base;
+            }
+        }
+
+        pos = automaton->free_next[pos];
+    }
+}
+
+
+/**
+ * Description: Places the children of a trie node, keys[lo, hi) being
+ * the keys that go through it, and then their subtrees.
+ *
+ * @return 1 on success, 0 if out of memory.
+ *
+ */
+static int _place_node(aho_corasick_t *automaton, int32_t node,
+                       const ac_key_t *keys, size_t lo, size_t hi,
+                       size_t depth){
+
+    uint8_t codes[256];
+    size_t starts[257];
+    int count = 0;
+    size_t i;
+
+    // Sorted keys: the ones ending here come first, then groups by byte
+    while ((lo < hi) && (keys[lo].len == depth)){
+        automaton->cells[node].match = depth;
+        lo++;
+    }
+
+    for (i = lo; i < hi; i++){
+        uint8_t code = automaton->codes[(uint8_t) keys[i].key[depth]];
+
+        if ((count == 0) || (codes[count - 1] != code)){
+            codes[count] = code;
+            starts[count] = i;
+            count++;
+        }
+    }
+    starts[count] = hi;
+
+    if (count == 0){
+        return 1;
+    }
+
+    int32_t base = _find_base(automaton, codes, count);
+    if (base < 0){
+        return 0;
+    }
+
+    automaton->cells[node].base = base;
+    for (i = 0; i < (size_t) count; i++){
+        _take_cell(automaton, base + codes[i], node);
+    }
+    automaton->states += count;
+
+    for (i = 0; i < (size_t) count; i++){
+        if (!_place_node(automaton, base + codes[i], keys,
+                         starts[i], starts[i + 1], depth + 1)){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Description: Returns the child of a state, or -1 if there is none.
+ *
+ */
+static inline int32_t _child(const aho_corasick_t *automaton, int32_t state,
+                             int code){
+
+    int32_t child = automaton->cells[state].base + code;
+
+    if (((uint32_t) child < automaton->size)
+        && (automaton->cells[child].check == state)){
+        return child;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Description: Sets the failure links and the suffix matches, breadth
+ * first so the links of shorter states are ready.
+ *
+ * @return 1 on success, 0 if out of memory.
+ *
+ */
+static int _link_states(aho_corasick_t *automaton){
+    int32_t *queue = malloc(sizeof(int32_t) * automaton->states);
+    ac_cell_t *cells = automaton->cells;
+
+    if (queue == NULL){
+        return 0;
+    }
+
+    size_t head = 0, tail = 0;
+    int code;
+
+    queue[tail++] = AHO_CORASICK_START;
+
+    while (head < tail){
+        int32_t state = queue[head++];
+
+        for (code = 1; code <= automaton->alphabet; code++){
+            int32_t child = _child(automaton, state, code);
+            if (child < 0){
+                continue;
+            }
+
+            int32_t fail = AHO_CORASICK_START;
+            if (state != AHO_CORASICK_START){
+                int32_t suffix = cells[state].fail;
+
+                while (((fail = _child(automaton, suffix, code)) < 0)
+                       && (suffix != AHO_CORASICK_START)){
+                    suffix = cells[suffix].fail;
+                }
+                if (fail < 0){
+                    fail = AHO_CORASICK_START;
+                }
+            }
+
+            cells[child].fail = fail;
+            if (cells[child].match == 0){
+                cells[child].match = cells[fail].match;
+            }
+
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+
+    return 1;
+}
+
+
+/**
+ * Description: Compiles an automaton for a set of keys.
+ *
+ * @param keys    The keys, don't need to be '\0' ended.
+ * @param lengths The key lengths, keys longer than
+ *                `AHO_CORASICK_MAX_KEY_LENGTH` are ignored.
+ * @param count   The number of keys.
+ *
+ * @return An automaton or NULL if out of memory.
+ *
+ */
+aho_corasick_t *create_aho_corasick(const char **keys, const size_t *lengths,
+                                    size_t count){
+
+    aho_corasick_t *automaton = calloc(1, sizeof(aho_corasick_t));
+    ac_key_t *sorted = malloc(sizeof(ac_key_t) * (count + 1));
+    size_t i, j, kept = 0;
+
+    if ((automaton == NULL) || (sorted == NULL)){
+        free(automaton);
+        free(sorted);
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++){
+        if ((lengths[i] == 0) || (lengths[i] > AHO_CORASICK_MAX_KEY_LENGTH)){
+            continue;
+        }
+
+        sorted[kept++] = (ac_key_t) { keys[i], lengths[i] };
+        for (j = 0; j < lengths[i]; j++){
+            automaton->codes[(uint8_t) keys[i][j]] = 1;
+        }
+    }
+
+    qsort(sorted, kept, sizeof(ac_key_t), _compare_keys);
+
+    // Codes keep the byte order, so sorted keys group by code too
+    for (i = 0; i < 256; i++){
+        if (automaton->codes[i]){
+            automaton->codes[i] = ++automaton->alphabet;
+        }
+    }
+
+    automaton->free_head = -1;
+    automaton->free_tail = -1;
+
+    // The start state is cell 0, its own parent
+    int built = _reserve_cells(automaton, AC_INITIAL_CELLS - 1);
+    if (built){
+        _take_cell(automaton, AHO_CORASICK_START, AHO_CORASICK_START);
+        automaton->states = 1;
+
+        built = _place_node(automaton, AHO_CORASICK_START, sorted, 0, kept, 0)
+            && _link_states(automaton);
+    }
+
+    // Steps check the bounds, the free cells at the end are not needed
+    if (built){
+        while (automaton->cells[automaton->size - 1].check == AC_FREE){
+            automaton->size--;
+        }
+
+        ac_cell_t *cells = realloc(automaton->cells,
+                                   sizeof(ac_cell_t) * automaton->size);
+        if (cells != NULL){
+            automaton->cells = cells;
+        }
+    }
+
+    free(sorted);
+    free(automaton->free_next);
+    free(automaton->free_prev);
+    automaton->free_next = NULL;
+    automaton->free_prev = NULL;
+
+    if (!built){
+        free_aho_corasick(automaton);
+        return NULL;
+    }
+
+    return automaton;
+}
+
+
+/**
+ * Description: Frees an automaton.
+ *
+ * @param automaton The automaton to be freed.
+ *
+ */
+void free_aho_corasick(aho_corasick_t *automaton){
+    if (automaton != NULL){
+        free(automaton->cells);
+        free(automaton->free_next);
+        free(automaton->free_prev);
+    }
+
+    free(automaton);
+}
+
+
+/**
+ * Description: Runs the automaton over a text. For every position, gives
+ * the length of the longest key ending there.
+ *
+ * @param automaton The automaton.
+ * @param state     The state to start from, receives the final state so
+ *                  a text can be scanned in pieces.
+ * @param text      The text to scan.
+ * @param len       The text length.
+ * @param matches   Receives, for each text position, the length of the
+ *                  longest key that ends there (0 if none).
+ *
+ */
+void scan_aho_corasick(const aho_corasick_t *automaton,
+                       aho_corasick_state_t *state,
+                       const char *text, size_t len, uint16_t *matches){
+
+    aho_corasick_state_t current = *state;
+    size_t i;
+
+    for (i = 0; i < len; i++){
+        int code = automaton->codes[(uint8_t) text[i]];
+
+        if (code == 0){
+            // No key has this byte, nothing can go through it
+            current = AHO_CORASICK_START;
+        }
+        else {
+            int32_t next;
+
+            while (((next = _child(automaton, current, code)) < 0)
+                   && (current != AHO_CORASICK_START)){
+                current = automaton->cells[current].fail;
+            }
+            if (next >= 0){
+                current = next;
+            }
+        }
+
+        matches[i] = automaton->cells[current].match;
+    }
+
+    *state = current;
+}
+
+
+/**
+ * Description: Returns the number of states of the automaton.
+ *
+ * @param automaton The automaton.
+ *
+ * @return The number of trie nodes.
+ *
+ */
+size_t aho_corasick_states(const aho_corasick_t *automaton){
+    return automaton->states;
+}
+
+
+/**
+ * Description: Returns the memory used by the automaton tables.
+ *
+ * @param automaton The automaton.
+ *
+ * @return The size of the tables in bytes.
+ *
+ */
+size_t aho_corasick_size(const aho_corasick_t *automaton){
+    return automaton->size * sizeof(ac_cell_t);
+}
+
+
+#endif
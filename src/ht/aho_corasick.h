@@ -0,0 +1,107 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file aho_corasick.h
+ *
+ * @brief Aho-Corasick string matching automaton.
+ * Finds every occurrence of a set of keys in a single pass over a text,
+ *  no matter how the keys are delimited (or overlap).
+ *
+ * The trie is stored as a double array over the bytes used by the keys,
+ *  a transition is one `base + code` lookup checked against its parent.
+ *
+ */
+
+/**
+ * Aho-Corasick automaton datatype.
+ *
+ */
+struct aho_corasick;
+typedef struct aho_corasick aho_corasick_t;
+
+
+/**
+ * Automaton state datatype, `AHO_CORASICK_START` before any text.
+ *
+ */
+typedef int32_t aho_corasick_state_t;
+
+#define AHO_CORASICK_START 0
+
+
+/**
+ * Longest key the automaton will hold.
+ *
+ */
+#define AHO_CORASICK_MAX_KEY_LENGTH 256
+
+
+/**
+ * Description: Compiles an automaton for a set of keys.
+ *
+ * @param keys    The keys, don't need to be '\0' ended.
+ * @param lengths The key lengths, keys longer than
+ *                `AHO_CORASICK_MAX_KEY_LENGTH` are ignored.
+ * @param count   The number of keys.
+ *
+ * @return An automaton or NULL if out of memory.
+ *
+ */
+aho_corasick_t *create_aho_corasick(const char **keys, const size_t *lengths,
+                                    size_t count);
+
+
+/**
+ * Description: Frees an automaton.
+ *
+ * @param automaton The automaton to be freed.
+ *
+ */
+void free_aho_corasick(aho_corasick_t *automaton);
+
+
+/**
+ * Description: Runs the automaton over a text. For every position, gives
+ * the length of the longest key ending there.
+ *
+ * @param automaton The automaton.
+ * @param state     The state to start from, receives the final state so
+ *                  a text can be scanned in pieces.
+ * @param text      The text to scan.
+ * @param len       The text length.
+ * @param matches   Receives, for each text position, the length of the
+ *                  longest key that ends there (0 if none).
+ *
+ */
+void scan_aho_corasick(const aho_corasick_t *automaton,
+                       aho_corasick_state_t *state,
+                       const char *text, size_t len, uint16_t *matches);
+
+
+/**
+ * Description: Returns the number of states of the automaton.
+ *
+ * @param automaton The automaton.
+ *
+ * @return The number of trie nodes.
+ *
+ */
+size_t aho_corasick_states(const aho_corasick_t *automaton);
+
+
+/**
+ * Description: Returns the memory used by the automaton tables.
+ *
+ * @param automaton The automaton.
+ *
+ * @return The size of the tables in bytes.
+ *
+ */
+size_t aho_corasick_size(const aho_corasick_t *automaton);
+
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef ALLOC_STATS_C
+#define ALLOC_STATS_C
+
+#include "alloc_stats.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+/**
+ * @file alloc_stats.c
+ *
+ * @brief Allocation accounting implementation.
+ *
+ * Counters are relaxed atomics, the scoring threads allocate too. A
+ * snapshot is not taken atomically as a whole, which doesn't matter for
+ * the quiet points it is meant for (between generations or runs).
+ *
+ */
+
+/**
+ * Counters of a module, as updated.
+ *
+ */
+struct alloc_stats_counters {
+    atomic_ulong allocs;
+    atomic_ulong reallocs;
+    atomic_ulong frees;
+    atomic_ulong bytes;
+    atomic_long live;
+    atomic_long peak;
+};
+
+static struct alloc_stats_counters counters[ALLOC_MODULE_COUNT];
+
+static const char *ALLOC_MODULE_NAMES[ALLOC_MODULE_COUNT] = {
+    "transform",
+    "language model",
+    "score cache",
+    "hash table",
+    "frozen table",
+    "concurrent table",
+    "linked list",
+    "vector",
+    "arena",
+    "bloom filter",
+    "aho-corasick",
+};
+
+
+/**
+ * Description: Tells if the allocations are being counted.
+ *
+ * @return 1 if built with ALLOC_STATS, else 0.
+ *
+ */
+int alloc_stats_enabled(){
+#ifdef ALLOC_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * Description: Adds a change of the live bytes of a module, raising its
+ *  peak if needed.
+ *
+ */
+static void _add_live(struct alloc_stats_counters *c, long change){
+    long live = atomic_fetch_add_explicit(&c->live, change,
+                                          memory_order_relaxed) + change;
+    long peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+
+    while ((live > peak)
+           && !atomic_compare_exchange_weak_explicit(&c->peak, &peak, live,
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed));
+}
+
+
+/**
+ * Description: Counts a new block of a module.
+ *
+ */
+static void *_count_alloc(alloc_module_t module, void *ptr){
+    if (ptr != NULL){
+        struct alloc_stats_counters *c = &counters[module];
+        size_t size = malloc_usable_size(ptr);
+
+        atomic_fetch_add_explicit(&c->allocs, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->bytes, size, memory_order_relaxed);
+        _add_live(c, size);
+    }
+
+    return ptr;
+}
+
+
+void *alloc_stats_malloc(alloc_module_t module, size_t size){
+    return _count_alloc(module, malloc(size));
+}
+
+
+void *alloc_stats_calloc(alloc_module_t module, size_t count, size_t size){
+    return _count_alloc(module, calloc(count, size));
+}
+
+
+void *alloc_stats_aligned_alloc(alloc_module_t module, size_t alignment,
+                                size_t size){
+    return _count_alloc(module, aligned_alloc(alignment, size));
+}
+
+
+char *alloc_stats_strdup(alloc_module_t module, const char *s){
+    return _count_alloc(module, strdup(s));
+}
+
+
+char *alloc_stats_strndup(alloc_module_t module, const char *s, size_t n){
+    return _count_alloc(module, strndup(s, n));
+}
+
+
+void *alloc_stats_realloc(alloc_module_t module, void *ptr, size_t size){
+    if (ptr == NULL){
+        return _count_alloc(module, realloc(NULL, size));
+    }
+
+    size_t old_size = malloc_usable_size(ptr);
+    void *new_ptr = realloc(ptr, size);
+
+    if ((new_ptr != NULL) || (size == 0)){
+        struct alloc_stats_counters *c = &counters[module];
+        size_t new_size = new_ptr != NULL ? malloc_usable_size(new_ptr) : 0;
+
+        atomic_fetch_add_explicit(&c->reallocs, 1, memory_order_relaxed);
+        if (new_size > old_size){
+            atomic_fetch_add_explicit(&c->bytes, new_size - old_size,
+                                      memory_order_relaxed);
+        }
+        _add_live(c, (long) new_size - (long) old_size);
+    }
+
+    return new_ptr;
+}
+
+
+void alloc_stats_free(alloc_module_t module, void *ptr){
+    if (ptr != NULL){
+        struct alloc_stats_counters *c = &counters[module];
+
+        atomic_fetch_add_explicit(&c->frees, 1, memory_order_relaxed);
+        _add_live(c, -(long) malloc_usable_size(ptr));
+    }
+
+    free(ptr);
+}
+
+
+/**
+ * Description: Reads the resident set size of the process.
+ *
+ * @return The RSS in bytes, 0 if unknown.
+ *
+ */
+static long _resident_set_size(){
+    FILE *f = fopen("/proc/self/statm", "r");
+    long pages = 0;
+
+    if (f == NULL){
+        return 0;
+    }
+    if (fscanf(f, "%*s %li", &pages) != 1){
+        pages = 0;
+    }
+    fclose(f);
+
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+
+/**
+ * Description: Reads the counters.
+ *
+ * @param snapshot Where to copy them, with the current RSS.
+ *
+ */
+void take_alloc_snapshot(alloc_snapshot_t *snapshot){
+    int i;
+
+    for (i = 0; i < ALLOC_MODULE_COUNT; i++){
+        struct alloc_stats_counters *c = &counters[i];
+        alloc_counts_t *s = &snapshot->modules[i];
+
+        s->allocs = atomic_load_explicit(&c->allocs, memory_order_relaxed);
+        s->reallocs = atomic_load_explicit(&c->reallocs, memory_order_relaxed);
+        s->frees = atomic_load_explicit(&c->frees, memory_order_relaxed);
+        s->bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed);
+        s->live = atomic_load_explicit(&c->live, memory_order_relaxed);
+        s->peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+    }
+
+    snapshot->rss = _resident_set_size();
+}
+
+
+/**
+ * Description: Sets the peak of every module to its live bytes, so peaks
+ *  cover from now on.
+ *
+ */
+void reset_alloc_peaks(){
+    int i;
+
+    for (i = 0; i < ALLOC_MODULE_COUNT; i++){
+        atomic_store_explicit(&counters[i].peak,
+                              atomic_load_explicit(&counters[i].live,
+                                                   memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+}
+
+
+/**
+ * Description: Writes a table of what every module allocated between two
+ *  snapshots, averaged over some iterations. Modules that didn't allocate
+ *  and hold nothing are left out.
+ *
+ * @param f          Output file.
+ * @param title      First column header.
+ * @param since      Earlier snapshot.
+ * @param until      Later snapshot, its peaks are the ones reported.
+ * @param iterations Iterations between the snapshots, counts and bytes
+ *                   are divided by it.
+ *
+ */
+void report_alloc_stats(FILE *f, const char *title,
+                        const alloc_snapshot_t *since,
+                        const alloc_snapshot_t *until,
+                        unsigned long iterations){
+    double per = iterations > 0 ? 1.0 / iterations : 1;
+    int i;
+
+    fprintf(f, "%-18s %12s %12s %12s %14s %14s %14s %14s\n", title,
+            "allocs/it", "reallocs/it", "frees/it", "bytes/it",
+            "live growth", "live", "peak live");
+
+    for (i = 0; i < ALLOC_MODULE_COUNT; i++){
+        const alloc_counts_t *a = &since->modules[i];
+        const alloc_counts_t *b = &until->modules[i];
+
+        if ((b->allocs == a->allocs) && (b->reallocs == a->reallocs)
+            && (b->frees == a->frees) && (b->live == 0)){
+            continue;
+        }
+
+        fprintf(f, "%-18s %12.1f %12.1f %12.1f %14.1f %14li %14li %14li\n",
+                ALLOC_MODULE_NAMES[i],
+                (b->allocs - a->allocs) * per,
+                (b->reallocs - a->reallocs) * per,
+                (b->frees - a->frees) * per,
+                (b->bytes - a->bytes) * per,
+                b->live - a->live, b->live, b->peak);
+    }
+
+    fprintf(f, "%-18s %li KiB (%+li KiB)\n", "RSS",
+            until->rss / 1024, (until->rss - since->rss) / 1024);
+}
+
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file alloc_stats.h
+ *
+ * @brief Allocation accounting per module.
+ * Built with ALLOC_STATS defined (make ALLOC_STATS=1), the modules that
+ *  define ALLOC_MODULE before including this header have their malloc,
+ *  calloc, aligned_alloc, realloc, strdup, strndup and free calls
+ *  counted. Otherwise the header
+ *  changes nothing and the counters stay at 0.
+ *
+ * Sizes are the usable sizes of the blocks, so memory allocated by one
+ *  module and freed by another is subtracted from the live bytes of the
+ *  latter, which can go below 0.
+ *
+ */
+
+/**
+ * Modules with their allocations counted.
+ *
+ */
+typedef enum {
+    ALLOC_TRANSFORM,
+    ALLOC_LANGUAGE_MODEL,
+    ALLOC_SCORE_CACHE,
+    ALLOC_HASH_TABLE,
+    ALLOC_FROZEN_HASH_TABLE,
+    ALLOC_CONCURRENT_HASH_TABLE,
+    ALLOC_LINKED_LIST,
+    ALLOC_VECTOR,
+    ALLOC_ARENA,
+    ALLOC_BLOOM_FILTER,
+    ALLOC_AHO_CORASICK,
+    ALLOC_MODULE_COUNT
+} alloc_module_t;
+
+
+/**
+ * Counters of a module.
+ *
+ */
+typedef struct {
+    unsigned long allocs;   /* malloc, calloc, aligned_alloc, strdup,
+                               strndup and realloc of NULL */
+    unsigned long reallocs;
+    unsigned long frees;
+    unsigned long bytes;    /* allocated, growing reallocs add the growth */
+    long live;              /* bytes allocated and not yet freed */
+    long peak;              /* highest `live` since the peaks were reset */
+} alloc_counts_t;
+
+
+/**
+ * Counters of every module at some point, with the resident set size.
+ *
+ */
+typedef struct {
+    alloc_counts_t modules[ALLOC_MODULE_COUNT];
+    long rss;
+} alloc_snapshot_t;
+
+
+/**
+ * Description: Tells if the allocations are being counted.
+ *
+ * @return 1 if built with ALLOC_STATS, else 0.
+ *
+ */
+int alloc_stats_enabled();
+
+
+/**
+ * Description: Reads the counters.
+ *
+ * @param snapshot Where to copy them, with the current RSS.
+ *
+ */
+void take_alloc_snapshot(alloc_snapshot_t *snapshot);
+
+
+/**
+ * Description: Sets the peak of every module to its live bytes, so peaks
+ *  cover from now on.
+ *
+ */
+void reset_alloc_peaks();
+
+
+/**
+ * Description: Writes a table of what every module allocated between two
+ *  snapshots, averaged over some iterations.
+ *
+ * @param f          Output file.
+ * @param title      First column header.
+ * @param since      Earlier snapshot.
+ * @param until      Later snapshot, its peaks are the ones reported.
+ * @param iterations Iterations between the snapshots, counts and bytes
+ *                   are divided by it.
+ *
+ */
+void report_alloc_stats(FILE *f, const char *title,
+                        const alloc_snapshot_t *since,
+                        const alloc_snapshot_t *until,
+                        unsigned long iterations);
+
+
+void *alloc_stats_malloc(alloc_module_t module, size_t size);
+void *alloc_stats_calloc(alloc_module_t module, size_t count, size_t size);
+void *alloc_stats_aligned_alloc(alloc_module_t module, size_t alignment,
+                                size_t size);
+void *alloc_stats_realloc(alloc_module_t module, void *ptr, size_t size);
+char *alloc_stats_strdup(alloc_module_t module, const char *s);
+char *alloc_stats_strndup(alloc_module_t module, const char *s, size_t n);
+void alloc_stats_free(alloc_module_t module, void *ptr);
+
+
+#if defined(ALLOC_STATS) && defined(ALLOC_MODULE)
+
+/*
+ * Object like macros, so `free` passed as a destructor is counted too.
+ */
+static inline void *_alloc_stats_malloc(size_t size){
+    return alloc_stats_malloc(ALLOC_MODULE, size);
+}
+
+static inline void *_alloc_stats_calloc(size_t count, size_t size){
+    return alloc_stats_calloc(ALLOC_MODULE, count, size);
+}
+
+static inline void *_alloc_stats_aligned_alloc(size_t alignment,
+                                               size_t size){
+    return alloc_stats_aligned_alloc(ALLOC_MODULE, alignment, size);
+}
+
+static inline void *_alloc_stats_realloc(void *ptr, size_t size){
+    return alloc_stats_realloc(ALLOC_MODULE, ptr, size);
+}
+
+static inline char *_alloc_stats_strdup(const char *s){
+    return alloc_stats_strdup(ALLOC_MODULE, s);
+}
+
+static inline char *_alloc_stats_strndup(const char *s, size_t n){
+    return alloc_stats_strndup(ALLOC_MODULE, s, n);
+}
+
+static inline void _alloc_stats_free(void *ptr){
+    alloc_stats_free(ALLOC_MODULE, ptr);
+}
+
+#define malloc _alloc_stats_malloc
+#define calloc _alloc_stats_calloc
+#define aligned_alloc _alloc_stats_aligned_alloc
+#define realloc _alloc_stats_realloc
+#define strdup _alloc_stats_strdup
+#define strndup _alloc_stats_strndup
+#define free _alloc_stats_free
+
+#endif
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef ARENA_C
+#define ARENA_C
+
+#include "arena.h"
+#include <stdalign.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ALLOC_MODULE ALLOC_ARENA
+#include "alloc_stats.h"
+
+/**
+ * @file arena.c
+ *
+ * @brief Bump allocator implementation.
+ *
+ * Chunks are kept in a list, newest first. Allocations that don't fit in
+ * the current chunk start a new one (as big as needed), the space left in
+ * the old one is not reused.
+ *
+ */
+
+/**
+ * Default size of the arena chunks.
+ *
+ */
+#define ARENA_CHUNK_SIZE 0x10000
+
+
+/**
+ * Arena chunk.
+ *
+ */
+typedef struct arena_chunk{
+    struct arena_chunk *next;
+    size_t used;
+    size_t size;
+    alignas(max_align_t) char data[];
+}arena_chunk_t;
+
+
+/**
+ * Arena structure.
+ *
+ */
+struct arena{
+    size_t chunk_size;
+    size_t reserved;
+    arena_chunk_t *chunks;
+};
+
+
+/**
+ * Description: Returns an empty arena.
+ *
+ * @param chunk_size The size of the chunks, 0 for the default.
+ *
+ * @return An arena or NULL if out of memory.
+ *
+ */
+arena_t *create_arena(size_t chunk_size){
+    arena_t *arena = (arena_t *) malloc(sizeof(arena_t));
+    if (arena == NULL){
+        return NULL;
+    }
+
+    arena->chunk_size = chunk_size > 0 ? chunk_size : ARENA_CHUNK_SIZE;
+    arena->reserved = 0;
+    arena->chunks = NULL;
+
+    return arena;
+}
+
+
+/**
+ * Description: Frees an arena and everything allocated from it.
+ *
+ * @param arena The arena to be freed.
+ *
+ */
+void free_arena(arena_t *arena){
+    if (arena == NULL){
+        return;
+    }
+
+    while (arena->chunks != NULL){
+        arena_chunk_t *next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+
+    free(arena);
+}
+
+
+/**
+ * Description: Allocates memory from a chunk, without alignment.
+ *
+ * @param arena The arena.
+ * @param size  The number of bytes.
+ *
+ * @return The memory or NULL if out of memory.
+ *
+ */
+static void *_arena_bump(arena_t *arena, size_t size){
+    arena_chunk_t *chunk = arena->chunks;
+
+    if ((chunk == NULL) || ((chunk->used + size) > chunk->size)){
+        size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+
+        chunk = (arena_chunk_t *) malloc(sizeof(arena_chunk_t) + chunk_size);
+        if (chunk == NULL){
+            return NULL;
+        }
+
+        chunk->next = arena->chunks;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        arena->chunks = chunk;
+        arena->reserved += chunk_size;
+    }
+
+    void *memory = &chunk->data[chunk->used];
+    chunk->used += size;
+
+    return memory;
+}
+
+
+/**
+ * Description: Allocates memory from an arena, aligned for any type.
+ *
+ * @param arena The arena.
+ * @param size  The number of bytes.
+ *
+ * @return The memory or NULL if out of memory.
+ *
+ */
+void *arena_alloc(arena_t *arena, size_t size){
+    const size_t alignment = alignof(max_align_t);
+
+    if (arena->chunks != NULL){
+        arena->chunks->used = (arena->chunks->used + alignment - 1)
+            & ~(alignment - 1);
+
+        if (arena->chunks->used > arena->chunks->size){
+            arena->chunks->used = arena->chunks->size;
+        }
+    }
+
+    return _arena_bump(arena, size);
+}
+
+
+/**
+ * Description: Copies a string to an arena.
+ *
+ * @param arena The arena.
+ * @param s     The string, doesn't need to be '\0' ended.
+ * @param len   The string length.
+ *
+ * @return The '\0' ended copy or NULL if out of memory.
+ *
+ */
+char *arena_strndup(arena_t *arena, const char *s, size_t len){
+    char *copy = (char *) _arena_bump(arena, len + 1);
+
+    if (copy != NULL){
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+
+/**
+ * Description: Returns the memory reserved by an arena.
+ *
+ * @param arena The arena.
+ *
+ * @return The size of its chunks in bytes.
+ *
+ */
+size_t arena_size(const arena_t *arena){
+    return arena->reserved;
+}
+
+
+#endif
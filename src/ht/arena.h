@@ -0,0 +1,80 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+
+/**
+ * @file arena.h
+ *
+ * @brief Bump allocator.
+ * Memory is handed out from large chunks and released all at once when
+ *  the arena is freed, so many small allocations cost a pointer bump and
+ *  end up next to each other.
+ *
+ */
+
+/**
+ * Arena datatype.
+ *
+ */
+struct arena;
+typedef struct arena arena_t;
+
+
+/**
+ * Description: Returns an empty arena.
+ *
+ * @param chunk_size The size of the chunks, 0 for the default.
+ *
+ * @return An arena or NULL if out of memory.
+ *
+ */
+arena_t *create_arena(size_t chunk_size);
+
+
+/**
+ * Description: Frees an arena and everything allocated from it.
+ *
+ * @param arena The arena to be freed.
+ *
+ */
+void free_arena(arena_t *arena);
+
+
+/**
+ * Description: Allocates memory from an arena, aligned for any type.
+ *
+ * @param arena The arena.
+ * @param size  The number of bytes.
+ *
+ * @return The memory or NULL if out of memory.
+ *
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+
+/**
+ * Description: Copies a string to an arena.
+ *
+ * @param arena The arena.
+ * @param s     The string, doesn't need to be '\0' ended.
+ * @param len   The string length.
+ *
+ * @return The '\0' ended copy or NULL if out of memory.
+ *
+ */
+char *arena_strndup(arena_t *arena, const char *s, size_t len);
+
+
+/**
+ * Description: Returns the memory reserved by an arena.
+ *
+ * @param arena The arena.
+ *
+ * @return The size of its chunks in bytes.
+ *
+ */
+size_t arena_size(const arena_t *arena);
+
+
+#endif
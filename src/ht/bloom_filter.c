@@ -0,0 +1,254 @@
+#ifndef BLOOM_FILTER_C
+#define BLOOM_FILTER_C
+
+#include "bloom_filter.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#define ALLOC_MODULE ALLOC_BLOOM_FILTER
+#include "alloc_stats.h"
+
+/**
+ * @file bloom_filter.c
+ *
+ * @brief Blocked bloom filter implementation.
+ *
+ * The high half of the hash picks a 512 bit block, the low half is split
+ * in two 16 bit values that generate the bit positions in the block
+ * (double hashing).
+ *
+ */
+
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_WORDS * 64)
+#define BLOOM_BLOCKING_OVERHEAD 1.5
+#define BLOOM_MAX_HASHES 16
+
+/**
+ * Bloom filter block, one cache line.
+ *
+ */
+typedef struct {
+    uint64_t words[BLOOM_BLOCK_WORDS];
+} bloom_block_t;
+
+
+/**
+ * Bloom filter structure.
+ *
+ */
+struct bloom_filter{
+    size_t block_count;
+    int hashes;
+    bloom_block_t *blocks;
+};
+
+
+/**
+ * Description: Returns a bloom filter using (at most) the given memory.
+ *
+ * @param bytes  The memory budget for the filter bits.
+ * @param hashes The number of bits set for each element.
+ *
+ * @return A bloom filter or NULL if the budget is smaller than a block.
+ *
+ */
+bloom_filter_t *create_bloom_filter(size_t bytes, int hashes){
+    size_t block_count = bytes / sizeof(bloom_block_t);
+    if ((block_count == 0) || (hashes < 1)){
+        return NULL;
+    }
+
+    bloom_filter_t *filter = (bloom_filter_t *) malloc(sizeof(bloom_filter_t));
+    assert(filter != NULL);
+
+    filter->blocks = (bloom_block_t *) aligned_alloc(sizeof(bloom_block_t),
+                                                     block_count * sizeof(bloom_block_t));
+    if (filter->blocks == NULL){
+        free(filter);
+        return NULL;
+    }
+
+    memset(filter->blocks, 0, block_count * sizeof(bloom_block_t));
+    filter->block_count = block_count;
+    filter->hashes = hashes;
+
+    return filter;
+}
+
+
+/**
+ * Description: Returns a bloom filter sized for a number of elements and
+ * a target false positive rate.
+ *
+ * @param elements The expected number of elements.
+ * @param rate     The target false positive rate, in (0, 1).
+ *
+ * @return A bloom filter or NULL if the parameters are not valid.
+ *
+ */
+bloom_filter_t *create_bloom_filter_for_rate(size_t elements, double rate){
+    if ((rate <= 0) || (rate >= 1)){
+        return NULL;
+    }
+
+    // Optimal bits and hashes for a flat filter, blocking uneven loads
+    // raise the rate so it gets a few more bits
+    double bits_per_element = (-log(rate) / (M_LN2 * M_LN2)) * BLOOM_BLOCKING_OVERHEAD;
+    int hashes = lround(-log2(rate));
+
+    if (hashes < 1){
+        hashes = 1;
+    }
+    if (hashes > BLOOM_MAX_HASHES){
+        hashes = BLOOM_MAX_HASHES;
+    }
+
+    size_t bits = ceil(bits_per_element * (elements > 0? elements : 1));
+    size_t blocks = (bits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+
+    return create_bloom_filter(blocks * sizeof(bloom_block_t), hashes);
+}
+
+
+/**
+ * Description: Frees a bloom filter.
+ *
+ * @param filter The bloom filter to be freed.
+ *
+ */
+void free_bloom_filter(bloom_filter_t *filter){
+    if (filter != NULL){
+        free(filter->blocks);
+    }
+
+    free(filter);
+}
+
+
+/**
+ * Description: Returns the block associated to a hash.
+ *
+ * @param filter The bloom filter.
+ * @param hash   The element hash.
+ *
+ * @return The block to set or check.
+ *
+ */
+static bloom_block_t *_bloom_block(const bloom_filter_t *filter, uint64_t hash){
+    // Maps the high half to [0, block_count) without a division
+    size_t index = ((hash >> 32) * filter->block_count) >> 32;
+
+    return &filter->blocks[index];
+}
+
+
+/**
+ * Description: Adds an element to the bloom filter.
+ *
+ * @param filter The bloom filter.
+ * @param hash   The element hash.
+ *
+ */
+void add_bloom_filter(bloom_filter_t *filter, uint64_t hash){
+    bloom_block_t *block = _bloom_block(filter, hash);
+    uint32_t h1 = hash & 0xFFFF;
+    uint32_t h2 = ((hash >> 16) & 0xFFFF) | 1;
+    int i;
+
+    for (i = 0; i < filter->hashes; i++){
+        uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+
+        block->words[bit / 64] |= ((uint64_t) 1) << (bit % 64);
+    }
+}
+
+
+/**
+ * Description: Checks if an element may be in the bloom filter.
+ *
+ * @param filter The bloom filter.
+ * @param hash   The element hash.
+ *
+ * @return 0 if the element was never added, 1 if it may have been.
+ *
+ */
+int check_bloom_filter(const bloom_filter_t *filter, uint64_t hash){
+    const bloom_block_t *block = _bloom_block(filter, hash);
+    uint32_t h1 = hash & 0xFFFF;
+    uint32_t h2 = ((hash >> 16) & 0xFFFF) | 1;
+    int i;
+
+    for (i = 0; i < filter->hashes; i++){
+        uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+
+        if ((block->words[bit / 64] & (((uint64_t) 1) << (bit % 64))) == 0){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Description: Adds the elements of `src` to `dst`.
+ *
+ * @param dst The bloom filter to be updated.
+ * @param src The bloom filter to be added.
+ *
+ * @return 1 if the filters were merged, 0 if they have different shapes.
+ *
+ */
+int merge_bloom_filters(bloom_filter_t *dst, const bloom_filter_t *src){
+    if ((dst->block_count != src->block_count)
+        || (dst->hashes != src->hashes)){
+        return 0;
+    }
+
+    size_t i;
+    int j;
+    for (i = 0; i < dst->block_count; i++){
+        for (j = 0; j < BLOOM_BLOCK_WORDS; j++){
+            dst->blocks[i].words[j] |= src->blocks[i].words[j];
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Description: Checks if two bloom filters hold the same bits.
+ *
+ * @param filter1 A bloom filter.
+ * @param filter2 Another bloom filter.
+ *
+ * @return 1 if both filters are equal, 0 otherwise.
+ *
+ */
+int equal_bloom_filters(const bloom_filter_t *filter1,
+                        const bloom_filter_t *filter2){
+
+    return (filter1->block_count == filter2->block_count)
+        && (filter1->hashes == filter2->hashes)
+        && (memcmp(filter1->blocks, filter2->blocks,
+                   filter1->block_count * sizeof(bloom_block_t)) == 0);
+}
+
+
+/**
+ * Description: Returns the memory used by the filter bits.
+ *
+ * @param filter The bloom filter.
+ *
+ * @return The size of the filter bits in bytes.
+ *
+ */
+size_t bloom_filter_size(const bloom_filter_t *filter){
+    return filter->block_count * sizeof(bloom_block_t);
+}
+
+
+#endif
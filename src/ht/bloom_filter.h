@@ -0,0 +1,118 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file bloom_filter.h
+ *
+ * @brief Blocked bloom filter.
+ * A bloom filter whose bits for a given element all fall in the same
+ *  cache line, so a lookup costs a single memory access.
+ *
+ * Elements are represented by a 64 bit hash, computed by the caller.
+ *
+ */
+
+/**
+ * Bloom filter datatype.
+ *
+ */
+struct bloom_filter;
+typedef struct bloom_filter bloom_filter_t;
+
+
+/**
+ * Description: Returns a bloom filter using (at most) the given memory.
+ *
+ * @param bytes  The memory budget for the filter bits.
+ * @param hashes The number of bits set for each element.
+ *
+ * @return A bloom filter or NULL if the budget is smaller than a block.
+ *
+ */
+bloom_filter_t *create_bloom_filter(size_t bytes, int hashes);
+
+
+/**
+ * Description: Returns a bloom filter sized for a number of elements and
+ * a target false positive rate.
+ *
+ * @param elements The expected number of elements.
+ * @param rate     The target false positive rate, in (0, 1).
+ *
+ * @return A bloom filter or NULL if the parameters are not valid.
+ *
+ */
+bloom_filter_t *create_bloom_filter_for_rate(size_t elements, double rate);
+
+
+/**
+ * Description: Frees a bloom filter.
+ *
+ * @param filter The bloom filter to be freed.
+ *
+ */
+void free_bloom_filter(bloom_filter_t *filter);
+
+
+/**
+ * Description: Adds an element to the bloom filter.
+ *
+ * @param filter The bloom filter.
+ * @param hash   The element hash.
+ *
+ */
+void add_bloom_filter(bloom_filter_t *filter, uint64_t hash);
+
+
+/**
+ * Description: Checks if an element may be in the bloom filter.
+ *
+ * @param filter The bloom filter.
+ * @param hash   The element hash.
+ *
+ * @return 0 if the element was never added, 1 if it may have been.
+ *
+ */
+int check_bloom_filter(const bloom_filter_t *filter, uint64_t hash);
+
+
+/**
+ * Description: Adds the elements of `src` to `dst`.
+ *
+ * @param dst The bloom filter to be updated.
+ * @param src The bloom filter to be added.
+ *
+ * @return 1 if the filters were merged, 0 if they have different shapes.
+ *
+ */
+int merge_bloom_filters(bloom_filter_t *dst, const bloom_filter_t *src);
+
+
+/**
+ * Description: Checks if two bloom filters hold the same bits.
+ *
+ * @param filter1 A bloom filter.
+ * @param filter2 Another bloom filter.
+ *
+ * @return 1 if both filters are equal, 0 otherwise.
+ *
+ */
+int equal_bloom_filters(const bloom_filter_t *filter1,
+                        const bloom_filter_t *filter2);
+
+
+/**
+ * Description: Returns the memory used by the filter bits.
+ *
+ * @param filter The bloom filter.
+ *
+ * @return The size of the filter bits in bytes.
+ *
+ */
+size_t bloom_filter_size(const bloom_filter_t *filter);
+
+
+#endif
@@ -0,0 +1,521 @@
+#ifndef CONCURRENT_HASH_TABLE_C
+#define CONCURRENT_HASH_TABLE_C
+
+#include "concurrent_hash_table.h"
+#include "arena.h"
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ALLOC_MODULE ALLOC_CONCURRENT_HASH_TABLE
+#include "alloc_stats.h"
+
+/**
+ * @file concurrent_hash_table.c
+ *
+ * @brief Concurrent hash table implementation.
+ *
+ * Each shard is an open addressing (linear probing) array of pointers to
+ * entries. Entries never move nor change, except for their atomic value,
+ * and are only published once complete, so readers just follow pointers.
+ *
+ * Growing a shard copies the pointers to a new array and publishes it.
+ * Readers may still be walking the old one, so it's kept until the table
+ * is freed (the retired arrays add up to less than the live one).
+ *
+ */
+
+/**
+ * Maximum load (out of 256) before a shard grows.
+ *
+ */
+#define CONCURRENT_MAX_LOAD 192
+
+/**
+ * Initial number of slots of a shard.
+ *
+ */
+#define CONCURRENT_SHARD_SIZE 64
+
+
+/**
+ * Table entry, allocated in the shard arena.
+ *
+ */
+typedef struct {
+    hash_t hash;
+    size_t length;
+    atomic_uintptr_t value;
+    char key[];
+} concurrent_entry_t;
+
+
+/**
+ * Slot array of a shard.
+ *
+ */
+typedef struct concurrent_slots{
+    struct concurrent_slots *retired; /* previous arrays, oldest last */
+    size_t capacity; /* always a power of two */
+    _Atomic(concurrent_entry_t *) entries[];
+} concurrent_slots_t;
+
+
+/**
+ * Table shard, each one in its own cache lines.
+ *
+ */
+typedef struct {
+    alignas(64) pthread_mutex_t lock;
+    _Atomic(concurrent_slots_t *) slots;
+    atomic_size_t count;
+    arena_t *arena;
+} concurrent_shard_t;
+
+
+/**
+ * Concurrent hash table structure.
+ *
+ */
+struct concurrent_hash_table{
+    concurrent_shard_t shards[CONCURRENT_HASH_TABLE_SHARDS];
+};
+
+
+/**
+ * Description: Allocates an empty slot array.
+ *
+ */
+static concurrent_slots_t *_create_slots(size_t capacity){
+    concurrent_slots_t *slots = (concurrent_slots_t *) calloc(
+        1, sizeof(concurrent_slots_t)
+        + capacity * sizeof(_Atomic(concurrent_entry_t *)));
+    assert(slots != NULL);
+
+    slots->capacity = capacity;
+
+    return slots;
+}
+
+
+/* Concurrent table creation/freeing */
+/**
+ * Description: Returns an empty concurrent hash table.
+ *
+ * @return A concurrent hash table.
+ *
+ */
+concurrent_hash_table_t create_concurrent_hash_table(){
+    concurrent_hash_table_t table = (concurrent_hash_table_t) aligned_alloc(
+        alignof(concurrent_shard_t), sizeof(struct concurrent_hash_table));
+    assert(table != NULL);
+
+    int i;
+    for (i = 0; i < CONCURRENT_HASH_TABLE_SHARDS; i++){
+        concurrent_shard_t *shard = &table->shards[i];
+
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->slots, _create_slots(CONCURRENT_SHARD_SIZE));
+        atomic_init(&shard->count, 0);
+        shard->arena = create_arena(0);
+        assert(shard->arena != NULL);
+    }
+
+    return table;
+}
+
+
+/**
+ * Description: Frees a concurrent hash table.
+ *
+ * @param table The table to be freed.
+ * @param free_content_f A function to free the values (NULL for none).
+ *
+ */
+void free_concurrent_hash_table(concurrent_hash_table_t table,
+                                void (* free_content_f) (void *)){
+    if (table == NULL){
+        return;
+    }
+
+    int i;
+    for (i = 0; i < CONCURRENT_HASH_TABLE_SHARDS; i++){
+        concurrent_shard_t *shard = &table->shards[i];
+        concurrent_slots_t *slots = atomic_load(&shard->slots);
+        size_t j;
+
+        if (free_content_f != NULL){
+            for (j = 0; j < slots->capacity; j++){
+                concurrent_entry_t *entry = atomic_load(&slots->entries[j]);
+
+                if (entry != NULL){
+                    free_content_f((void *) atomic_load(&entry->value));
+                }
+            }
+        }
+
+        while (slots != NULL){
+            concurrent_slots_t *retired = slots->retired;
+            free(slots);
+            slots = retired;
+        }
+
+        free_arena(shard->arena);
+        pthread_mutex_destroy(&shard->lock);
+    }
+
+    free(table);
+}
+
+
+/* Concurrent table manipulation */
+/**
+ * Description: Returns the shard of a key hash, chosen by the high bits
+ * (the low ones pick the slot).
+ *
+ */
+static concurrent_shard_t *_shard(concurrent_hash_table_t table, hash_t hash){
+    uint64_t index = (((unsigned __int128) hash)
+                      * CONCURRENT_HASH_TABLE_SHARDS) >> 64;
+
+    return &table->shards[index];
+}
+
+
+/**
+ * Description: Looks for an entry in a slot array.
+ *
+ * @return The entry or NULL if not found.
+ *
+ */
+static concurrent_entry_t *_find_entry(const concurrent_slots_t *slots,
+                                       const char *s, size_t len, hash_t hash){
+
+    size_t mask = slots->capacity - 1;
+    size_t i = hash & mask;
+
+    for (;;){
+        concurrent_entry_t *entry = atomic_load_explicit(&slots->entries[i],
+                                                         memory_order_acquire);
+        if (entry == NULL){
+            return NULL;
+        }
+
+        if ((entry->hash == hash) && (entry->length == len)
+            && (memcmp(entry->key, s, len) == 0)){
+            return entry;
+        }
+
+        i = (i + 1) & mask;
+    }
+}
+
+
+/**
+ * Description: Looks for an entry without locking.
+ *
+ */
+static concurrent_entry_t *_find_shard_entry(concurrent_shard_t *shard,
+                                             const char *s, size_t len,
+                                             hash_t hash){
+
+    return _find_entry(atomic_load_explicit(&shard->slots, memory_order_acquire),
+                       s, len, hash);
+}
+
+
+/**
+ * Description: Puts an entry pointer in the first free slot of its probe
+ * sequence.
+ *
+ */
+static void _place_entry(concurrent_slots_t *slots, concurrent_entry_t *entry){
+    size_t mask = slots->capacity - 1;
+    size_t i = entry->hash & mask;
+
+    while (atomic_load_explicit(&slots->entries[i], memory_order_relaxed) != NULL){
+        i = (i + 1) & mask;
+    }
+
+    atomic_store_explicit(&slots->entries[i], entry, memory_order_release);
+}
+
+
+/**
+ * Description: Adds a new entry to a shard, the shard lock must be held.
+ *
+ * @return The new entry.
+ *
+ */
+static concurrent_entry_t *_insert_entry(concurrent_shard_t *shard,
+                                         const char *s, size_t len,
+                                         hash_t hash, uintptr_t value){
+
+    concurrent_slots_t *slots = atomic_load_explicit(&shard->slots,
+                                                     memory_order_relaxed);
+    size_t count = atomic_load_explicit(&shard->count, memory_order_relaxed);
+
+    if (((count + 1) * 256) > (slots->capacity * CONCURRENT_MAX_LOAD)){
+        concurrent_slots_t *grown = _create_slots(slots->capacity * 2);
+        size_t i;
+
+        for (i = 0; i < slots->capacity; i++){
+            concurrent_entry_t *entry = atomic_load_explicit(
+                &slots->entries[i], memory_order_relaxed);
+
+            if (entry != NULL){
+                _place_entry(grown, entry);
+            }
+        }
+
+        grown->retired = slots;
+        atomic_store_explicit(&shard->slots, grown, memory_order_release);
+        slots = grown;
+    }
+
+    concurrent_entry_t *entry = (concurrent_entry_t *) arena_alloc(
+        shard->arena, sizeof(concurrent_entry_t) + len + 1);
+    assert(entry != NULL);
+
+    entry->hash = hash;
+    entry->length = len;
+    atomic_init(&entry->value, value);
+    memcpy(entry->key, s, len);
+    entry->key[len] = '\0';
+
+    _place_entry(slots, entry);
+    atomic_store_explicit(&shard->count, count + 1, memory_order_relaxed);
+
+    return entry;
+}
+
+
+/**
+ * Description: Inserts a value indexed by a string of known length and
+ * hash into the table.
+ *
+ * @param table The table to insert in.
+ * @param s     The table index, doesn't need to be '\0' ended.
+ * @param len   The index length.
+ * @param hash  The index hash, as returned by `get_hash_n`.
+ * @param v     The value to insert.
+ *
+ */
+void insert_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                            const char *s, size_t len,
+                                            hash_t hash, void *v){
+
+    concurrent_shard_t *shard = _shard(table, hash);
+
+    pthread_mutex_lock(&shard->lock);
+
+    concurrent_entry_t *entry = _find_shard_entry(shard, s, len, hash);
+    if (entry != NULL){
+        atomic_store(&entry->value, (uintptr_t) v);
+    }
+    else {
+        _insert_entry(shard, s, len, hash, (uintptr_t) v);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+}
+
+
+/**
+ * Description: Inserts a value indexed by a string into the table.
+ *
+ * @param table The table to insert in.
+ * @param s     The table index.
+ * @param v     The value to insert.
+ *
+ */
+void insert_concurrent_hash_table(concurrent_hash_table_t table,
+                                  const char *s, void *v){
+    size_t len = strlen(s);
+
+    insert_concurrent_hash_table_prehashed(table, s, len, get_hash_n(s, len), v);
+}
+
+
+/**
+ * Description: Adds to the value of a key, as an integer, inserting the
+ * key when missing (as if its value was 0). Concurrent additions are
+ * never lost.
+ *
+ * @param table The table.
+ * @param s     The key, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ * @param delta The amount to add.
+ *
+ * @return The value after the addition.
+ *
+ */
+long add_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                         const char *s, size_t len,
+                                         hash_t hash, long delta){
+
+    concurrent_shard_t *shard = _shard(table, hash);
+
+    // Known keys only need the atomic addition
+    concurrent_entry_t *entry = _find_shard_entry(shard, s, len, hash);
+    if (entry != NULL){
+        return atomic_fetch_add(&entry->value, delta) + delta;
+    }
+
+    long value;
+
+    pthread_mutex_lock(&shard->lock);
+
+    entry = _find_shard_entry(shard, s, len, hash);
+    if (entry != NULL){
+        value = atomic_fetch_add(&entry->value, delta) + delta;
+    }
+    else {
+        _insert_entry(shard, s, len, hash, delta);
+        value = delta;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return value;
+}
+
+
+/**
+ * Description: Adds to the value of a key of known length, see
+ * `add_concurrent_hash_table_prehashed`.
+ *
+ * @param table The table.
+ * @param s     The key, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param delta The amount to add.
+ *
+ * @return The value after the addition.
+ *
+ */
+long add_concurrent_hash_table_n(concurrent_hash_table_t table,
+                                 const char *s, size_t len, long delta){
+
+    return add_concurrent_hash_table_prehashed(table, s, len,
+                                               get_hash_n(s, len), delta);
+}
+
+
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash, without locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                          const char *s, size_t len,
+                                          hash_t hash){
+
+    concurrent_entry_t *entry = _find_shard_entry(_shard(table, hash),
+                                                  s, len, hash);
+    if (entry == NULL){
+        return NULL;
+    }
+
+    return (void *) atomic_load(&entry->value);
+}
+
+
+/**
+ * Description: Obtains the value associated with a string of known
+ * length, without locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table_n(concurrent_hash_table_t table,
+                                  const char *s, size_t len){
+
+    return get_concurrent_hash_table_prehashed(table, s, len, get_hash_n(s, len));
+}
+
+
+/**
+ * Description: Obtains the value associated with a string, without
+ * locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table(concurrent_hash_table_t table, const char *s){
+    if (s == NULL){
+        return NULL;
+    }
+
+    return get_concurrent_hash_table_n(table, s, strlen(s));
+}
+
+
+/**
+ * Description: Returns the number of keys in the table.
+ *
+ * @param table The table.
+ *
+ * @return The number of keys.
+ *
+ */
+size_t concurrent_hash_table_count(concurrent_hash_table_t table){
+    size_t count = 0;
+    int i;
+
+    for (i = 0; i < CONCURRENT_HASH_TABLE_SHARDS; i++){
+        count += atomic_load_explicit(&table->shards[i].count,
+                                      memory_order_relaxed);
+    }
+
+    return count;
+}
+
+
+/**
+ * Description: Applies a function to every (key, value) pair of the
+ * table, not to be used while other threads write to it.
+ *
+ * @param table The table.
+ * @param f     The function, receives the key, the value and `data`.
+ * @param data  Passed to every call of f.
+ *
+ */
+void foreach_concurrent_hash_table(concurrent_hash_table_t table,
+                                   void (* f) (const char *, void *, void *),
+                                   void *data){
+    int i;
+
+    for (i = 0; i < CONCURRENT_HASH_TABLE_SHARDS; i++){
+        concurrent_slots_t *slots = atomic_load(&table->shards[i].slots);
+        size_t j;
+
+        for (j = 0; j < slots->capacity; j++){
+            concurrent_entry_t *entry = atomic_load(&slots->entries[j]);
+
+            if (entry != NULL){
+                f(entry->key, (void *) atomic_load(&entry->value), data);
+            }
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef CONCURRENT_HASH_TABLE_H
+#define CONCURRENT_HASH_TABLE_H
+
+#include <stdlib.h>
+
+#include "hash_table.h"
+
+/**
+ * @file concurrent_hash_table.h
+ *
+ * @brief String indexed hash table for several threads.
+ * Same keys and values as hash_table_t, but any number of threads can
+ *  insert, add to and read the table at the same time.
+ *
+ * The table is split in shards by key hash. Writers lock the shard of the
+ *  key, readers never lock nor retry: a read that races with the insertion
+ *  of its key may just not see it yet.
+ *
+ * Keys can't be removed. Freeing the table and iterating it are not
+ *  thread safe.
+ *
+ */
+
+/**
+ * Concurrent hash table datatype.
+ *
+ */
+struct concurrent_hash_table;
+typedef struct concurrent_hash_table *concurrent_hash_table_t;
+
+
+/**
+ * Number of shards of a concurrent table, a power of two.
+ *
+ */
+#ifndef CONCURRENT_HASH_TABLE_SHARDS
+    #define CONCURRENT_HASH_TABLE_SHARDS 64
+#endif
+
+
+/* Concurrent table creation/freeing */
+/**
+ * Description: Returns an empty concurrent hash table.
+ *
+ * @return A concurrent hash table.
+ *
+ */
+concurrent_hash_table_t create_concurrent_hash_table();
+
+
+/**
+ * Description: Frees a concurrent hash table.
+ *
+ * @param table The table to be freed.
+ * @param free_content_f A function to free the values (NULL for none).
+ *
+ */
+void free_concurrent_hash_table(concurrent_hash_table_t table,
+                                void (* free_content_f) (void *));
+
+
+/* Concurrent table manipulation */
+/**
+ * Description: Inserts a value indexed by a string of known length and
+ * hash into the table.
+ *
+ * @param table The table to insert in.
+ * @param s     The table index, doesn't need to be '\0' ended.
+ * @param len   The index length.
+ * @param hash  The index hash, as returned by `get_hash_n`.
+ * @param v     The value to insert.
+ *
+ */
+void insert_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                            const char *s, size_t len,
+                                            hash_t hash, void *v);
+
+
+/**
+ * Description: Inserts a value indexed by a string into the table.
+ *
+ * @param table The table to insert in.
+ * @param s     The table index.
+ * @param v     The value to insert.
+ *
+ */
+void insert_concurrent_hash_table(concurrent_hash_table_t table,
+                                  const char *s, void *v);
+
+
+/**
+ * Description: Adds to the value of a key, as an integer, inserting the
+ * key when missing (as if its value was 0). Concurrent additions are
+ * never lost.
+ *
+ * @param table The table.
+ * @param s     The key, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ * @param delta The amount to add.
+ *
+ * @return The value after the addition.
+ *
+ */
+long add_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                         const char *s, size_t len,
+                                         hash_t hash, long delta);
+
+
+/**
+ * Description: Adds to the value of a key of known length, see
+ * `add_concurrent_hash_table_prehashed`.
+ *
+ * @param table The table.
+ * @param s     The key, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param delta The amount to add.
+ *
+ * @return The value after the addition.
+ *
+ */
+long add_concurrent_hash_table_n(concurrent_hash_table_t table,
+                                 const char *s, size_t len, long delta);
+
+
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash, without locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table_prehashed(concurrent_hash_table_t table,
+                                          const char *s, size_t len,
+                                          hash_t hash);
+
+
+/**
+ * Description: Obtains the value associated with a string of known
+ * length, without locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table_n(concurrent_hash_table_t table,
+                                  const char *s, size_t len);
+
+
+/**
+ * Description: Obtains the value associated with a string, without
+ * locking.
+ *
+ * @param table The table to lookup in.
+ * @param s     The key string.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_concurrent_hash_table(concurrent_hash_table_t table, const char *s);
+
+
+/**
+ * Description: Returns the number of keys in the table.
+ *
+ * @param table The table.
+ *
+ * @return The number of keys.
+ *
+ */
+size_t concurrent_hash_table_count(concurrent_hash_table_t table);
+
+
+/**
+ * Description: Applies a function to every (key, value) pair of the
+ * table, not to be used while other threads write to it.
+ *
+ * @param table The table.
+ * @param f     The function, receives the key, the value and `data`.
+ * @param data  Passed to every call of f.
+ *
+ */
+void foreach_concurrent_hash_table(concurrent_hash_table_t table,
+                                   void (* f) (const char *, void *, void *),
+                                   void *data);
+
+
+#endif
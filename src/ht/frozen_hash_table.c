@@ -0,0 +1,714 @@
+#ifndef FROZEN_HASH_TABLE_C
+#define FROZEN_HASH_TABLE_C
+
+#include "frozen_hash_table.h"
+#include <assert.h>
+#include <string.h>
+
+#define ALLOC_MODULE ALLOC_FROZEN_HASH_TABLE
+#include "alloc_stats.h"
+
+/**
+ * @file frozen_hash_table.c
+ *
+ * @brief Immutable string indexed table implementation.
+ *
+ * Keys are split in buckets of ~FROZEN_BUCKET_LOAD keys. Each bucket gets a
+ * displacement pair (d0, d1) so its keys land on free slots at
+ * (f1 + d0 * f2 + d1) % count, where f1 and f2 come from the key hash.
+ * Buckets are placed from the largest to the smallest, single key buckets
+ * just take the remaining slots.
+ *
+ * Image layout (8 byte aligned sections):
+ *   header | displacements[2 * buckets] | key offsets[count + 1]
+ *          | values[count] | key blob
+ *
+ * The offsets are kept apart from the values so the ones a miss reads stay
+ * compact.
+ *
+ * Keys are placed with HASH_FUNCTION, which builds may replace: the header
+ * keeps a hash of the magic, images of another hash don't load.
+ *
+ */
+
+#define FROZEN_MAGIC "HAPPYMPH"
+#define FROZEN_VERSION 2
+#define FROZEN_BUCKET_LOAD 2
+#define FROZEN_MAX_D0 4096
+#define FROZEN_MAX_SEEDS 64
+
+/**
+ * Frozen table image header.
+ *
+ */
+typedef struct {
+    char magic[8];
+    uint64_t version;
+    uint64_t hash_check; /* Key hash of the magic */
+    uint64_t count;
+    uint64_t bucket_count;
+    uint64_t seed;
+    uint64_t blob_size;
+} frozen_header_t;
+
+
+/**
+ * Frozen hash table structure, pointers into the image.
+ *
+ */
+struct frozen_hash_table{
+    void *owned_image; /* NULL when the image is borrowed */
+    size_t image_size;
+
+    const frozen_header_t *header;
+    const uint32_t *displacements;
+    const uint32_t *offsets;
+    const uint64_t *values;
+    const char *blob;
+};
+
+
+/**
+ * Key being placed while freezing.
+ *
+ */
+typedef struct {
+    const char *key;
+    size_t len;
+    uint64_t value;
+    frozen_hash_t hash;
+    uint32_t f1, f2, bucket;
+} frozen_key_t;
+
+
+/**
+ * Description: Rounds a size up to 8 bytes.
+ *
+ */
+static size_t _align8(size_t size){
+    return (size + 7) & ~((size_t) 7);
+}
+
+
+/**
+ * Description: Returns the key hash of a string of known length.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+frozen_hash_t get_frozen_hash_n(const char *s, size_t len){
+    return get_hash_n(s, len);
+}
+
+
+/**
+ * Description: Returns the hash check of the images this build writes.
+ *
+ */
+static uint64_t _hash_check(){
+    return get_frozen_hash_n(FROZEN_MAGIC, strlen(FROZEN_MAGIC));
+}
+
+
+/**
+ * Description: Mixes a key hash with the table seed (murmur3 finalizer).
+ *
+ */
+static uint64_t _seeded_hash(frozen_hash_t hash, uint64_t seed){
+    uint64_t g = hash ^ seed;
+
+    g ^= g >> 33;
+    g *= 0xff51afd7ed558ccdUL;
+    g ^= g >> 33;
+    g *= 0xc4ceb9fe1a85ec53UL;
+    g ^= g >> 33;
+
+    return g;
+}
+
+
+/**
+ * Description: Maps a 32 bit value to [0, range) without a division.
+ *
+ */
+static uint32_t _reduce(uint32_t value, uint64_t range){
+    return (((uint64_t) value) * range) >> 32;
+}
+
+
+/**
+ * Description: Computes the placement parameters of a key.
+ *
+ */
+static void _split_hash(uint64_t g, uint64_t count, uint64_t bucket_count,
+                        uint32_t *f1, uint32_t *f2, uint32_t *bucket){
+
+    *f1 = _reduce(g, count);
+    *f2 = _reduce(g >> 32, count);
+    *bucket = _reduce((g * 0x9e3779b97f4a7c15UL) >> 32, bucket_count);
+}
+
+
+/**
+ * Description: Returns the image section sizes for a table.
+ *
+ */
+static size_t _image_size(uint64_t count, uint64_t bucket_count,
+                          uint64_t blob_size){
+
+    return _align8(sizeof(frozen_header_t))
+        + _align8(sizeof(uint32_t) * 2 * bucket_count)
+        + _align8(sizeof(uint32_t) * (count + 1))
+        + sizeof(uint64_t) * count
+        + blob_size;
+}
+
+
+/**
+ * Description: Points the table sections to an image.
+ *
+ * @param table The table to set up.
+ * @param image The table image.
+ *
+ */
+static void _map_image(frozen_hash_table_t table, const void *image){
+    const char *cursor = (const char *) image;
+
+    table->header = (const frozen_header_t *) cursor;
+    cursor += _align8(sizeof(frozen_header_t));
+
+    table->displacements = (const uint32_t *) cursor;
+    cursor += _align8(sizeof(uint32_t) * 2 * table->header->bucket_count);
+
+    table->offsets = (const uint32_t *) cursor;
+    cursor += _align8(sizeof(uint32_t) * (table->header->count + 1));
+
+    table->values = (const uint64_t *) cursor;
+    cursor += sizeof(uint64_t) * table->header->count;
+
+    table->blob = cursor;
+}
+
+
+/**
+ * Description: Checks that the displacements and key offsets of a mapped
+ * image stay in range, so lookups can't read out of it.
+ *
+ * @param table The table, mapped to its image.
+ *
+ * @return 1 if they do, 0 otherwise.
+ *
+ */
+static int _check_image(frozen_hash_table_t table){
+    const frozen_header_t *header = table->header;
+    uint64_t i;
+
+    for (i = 0; i < header->bucket_count; i++){
+        uint64_t d0 = table->displacements[2 * i];
+        uint64_t d1 = table->displacements[2 * i + 1];
+
+        if ((d0 >= FROZEN_MAX_D0) || ((d1 != 0) && (d1 >= header->count))){
+            return 0;
+        }
+    }
+
+    if (table->offsets[0] != 0){
+        return 0;
+    }
+    for (i = 0; i < header->count; i++){
+        if (table->offsets[i + 1] < table->offsets[i]){
+            return 0;
+        }
+    }
+
+    return table->offsets[header->count] == header->blob_size;
+}
+
+
+/**
+ * Description: Tries to place every key with a given seed.
+ *
+ * @param keys         The keys to place.
+ * @param count        The number of keys (and slots).
+ * @param bucket_count The number of buckets.
+ * @param seed         The hash seed.
+ * @param displacements Receives the (d0, d1) of each bucket.
+ * @param key_slots    Receives the slot of each key.
+ *
+ * @return 1 if all keys found a slot, 0 if another seed is needed.
+ *
+ */
+static int _place_keys(frozen_key_t *keys, size_t count, size_t bucket_count,
+                       uint64_t seed, uint32_t *displacements,
+                       uint32_t *key_slots){
+
+    size_t *bucket_start = calloc(bucket_count + 1, sizeof(size_t));
+    size_t *bucket_keys = malloc(sizeof(size_t) * count);
+    size_t *order = malloc(sizeof(size_t) * bucket_count);
+    size_t *size_start = NULL;
+    char *taken = calloc(count, 1);
+    size_t i, j, max_size = 0;
+    int placed = 1;
+
+    assert((bucket_start != NULL) && (bucket_keys != NULL)
+           && (order != NULL) && (taken != NULL));
+
+    // Counting sort of the keys by bucket
+    for (i = 0; i < count; i++){
+        uint64_t g = _seeded_hash(keys[i].hash, seed);
+
+        _split_hash(g, count, bucket_count,
+                    &keys[i].f1, &keys[i].f2, &keys[i].bucket);
+        bucket_start[keys[i].bucket + 1]++;
+    }
+    for (i = 0; i < bucket_count; i++){
+        size_t size = bucket_start[i + 1];
+        if (size > max_size){
+            max_size = size;
+        }
+        bucket_start[i + 1] += bucket_start[i];
+    }
+    {
+        size_t *fill = malloc(sizeof(size_t) * bucket_count);
+        assert(fill != NULL);
+
+        memcpy(fill, bucket_start, sizeof(size_t) * bucket_count);
+        for (i = 0; i < count; i++){
+            bucket_keys[fill[keys[i].bucket]++] = i;
+        }
+        free(fill);
+    }
+
+    // Counting sort of the buckets by decreasing size
+    size_start = calloc(max_size + 2, sizeof(size_t));
+    assert(size_start != NULL);
+    for (i = 0; i < bucket_count; i++){
+        size_start[max_size - (bucket_start[i + 1] - bucket_start[i]) + 1]++;
+    }
+    for (i = 0; i <= max_size; i++){
+        size_start[i + 1] += size_start[i];
+    }
+    for (i = 0; i < bucket_count; i++){
+        order[size_start[max_size - (bucket_start[i + 1] - bucket_start[i])]++] = i;
+    }
+
+    memset(displacements, 0, sizeof(uint32_t) * 2 * bucket_count);
+
+    size_t next_free = 0;
+    for (i = 0; (i < bucket_count) && placed; i++){
+        size_t bucket = order[i];
+        size_t first = bucket_start[bucket];
+        size_t size = bucket_start[bucket + 1] - first;
+
+        if (size == 0){
+            break;
+        }
+
+        if (size == 1){
+            // Take the next free slot: d0 = 0, d1 = slot - f1
+            frozen_key_t *key = &keys[bucket_keys[first]];
+
+            while (taken[next_free]){
+                next_free++;
+            }
+
+            displacements[2 * bucket + 1] = (next_free + count - key->f1) % count;
+            taken[next_free] = 1;
+            key_slots[bucket_keys[first]] = next_free;
+            continue;
+        }
+
+        uint64_t d0, d1;
+        size_t positions[size];
+        int found = 0;
+
+        for (d0 = 0; (d0 < FROZEN_MAX_D0) && !found; d0++){
+            // Positions for d1 = 0, then they just move one slot at a time
+            for (j = 0; j < size; j++){
+                const frozen_key_t *key = &keys[bucket_keys[first + j]];
+                positions[j] = (key->f1 + d0 * key->f2) % count;
+            }
+
+            for (d1 = 0; (d1 < count) && !found; d1++){
+                found = 1;
+
+                for (j = 0; (j < size) && found; j++){
+                    size_t k;
+
+                    found = !taken[positions[j]];
+                    for (k = 0; (k < j) && found; k++){
+                        found = positions[k] != positions[j];
+                    }
+                }
+
+                if (found){
+                    displacements[2 * bucket] = d0;
+                    displacements[2 * bucket + 1] = d1;
+                    break;
+                }
+
+                for (j = 0; j < size; j++){
+                    if (++positions[j] == count){
+                        positions[j] = 0;
+                    }
+                }
+            }
+        }
+
+        if (!found){
+            placed = 0;
+            break;
+        }
+
+        for (j = 0; j < size; j++){
+            taken[positions[j]] = 1;
+            key_slots[bucket_keys[first + j]] = positions[j];
+        }
+    }
+
+    free(taken);
+    free(size_start);
+    free(order);
+    free(bucket_keys);
+    free(bucket_start);
+
+    return placed;
+}
+
+
+/* Frozen table creation/freeing */
+/**
+ * Description: Builds a frozen copy of a hash table.
+ *
+ * @param table The hash table to freeze, values are stored as integers.
+ *
+ * @return A frozen hash table or NULL if out of memory.
+ *
+ */
+frozen_hash_table_t freeze_hash_table(hash_table_t table){
+    size_t count = hash_table_count(table);
+    size_t bucket_count = count / FROZEN_BUCKET_LOAD + 1;
+    size_t blob_size = 0;
+    size_t i;
+
+    frozen_key_t *keys = malloc(sizeof(frozen_key_t) * (count + 1));
+    uint32_t *displacements = malloc(sizeof(uint32_t) * 2 * bucket_count);
+    uint32_t *key_slots = malloc(sizeof(uint32_t) * (count + 1));
+    if ((keys == NULL) || (displacements == NULL) || (key_slots == NULL)){
+        free(keys);
+        free(displacements);
+        free(key_slots);
+        return NULL;
+    }
+
+    {
+        hash_table_iterator_t it = hash_table_iterator(table);
+        const char *key;
+        void *value;
+
+        for (i = 0; hash_table_next(&it, &key, &value); i++){
+            keys[i].key = key;
+            keys[i].len = strlen(key);
+            keys[i].value = (uintptr_t) value;
+            keys[i].hash = get_frozen_hash_n(key, keys[i].len);
+
+            blob_size += keys[i].len;
+        }
+    }
+
+    // Slots address the blob with 32 bit offsets
+    uint64_t seed = 0;
+    int attempt, placed = 0;
+    for (attempt = 1; (attempt <= FROZEN_MAX_SEEDS) && !placed
+             && (blob_size <= UINT32_MAX); attempt++){
+
+        seed = attempt * 0x9e3779b97f4a7c15UL;
+        placed = _place_keys(keys, count, bucket_count, seed,
+                             displacements, key_slots);
+    }
+
+    frozen_hash_table_t frozen = NULL;
+    size_t size = _image_size(count, bucket_count, blob_size);
+    char *image = placed ? calloc(1, size) : NULL;
+
+    if (image != NULL){
+        frozen = malloc(sizeof(struct frozen_hash_table));
+        assert(frozen != NULL);
+
+        frozen_header_t header = {
+            .version = FROZEN_VERSION,
+            .hash_check = _hash_check(),
+            .count = count,
+            .bucket_count = bucket_count,
+            .seed = seed,
+            .blob_size = blob_size,
+        };
+        memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+        memcpy(image, &header, sizeof(header));
+
+        frozen->owned_image = image;
+        frozen->image_size = size;
+        _map_image(frozen, image);
+
+        memcpy((uint32_t *) frozen->displacements, displacements,
+               sizeof(uint32_t) * 2 * bucket_count);
+
+        uint32_t *offsets = (uint32_t *) frozen->offsets;
+        uint64_t *values = (uint64_t *) frozen->values;
+        char *blob = (char *) frozen->blob;
+        size_t offset = 0;
+
+        // Keys are laid out in slot order
+        for (i = 0; i < count; i++){
+            offsets[key_slots[i]] = keys[i].len;
+            values[key_slots[i]] = keys[i].value;
+        }
+        for (i = 0; i < count; i++){
+            size_t len = offsets[i];
+
+            offsets[i] = offset;
+            offset += len;
+        }
+        offsets[count] = offset;
+
+        for (i = 0; i < count; i++){
+            memcpy(&blob[offsets[key_slots[i]]], keys[i].key, keys[i].len);
+        }
+    }
+
+    free(keys);
+    free(displacements);
+    free(key_slots);
+
+    return frozen;
+}
+
+
+/**
+ * Description: Uses a frozen table image, as written by
+ * `write_frozen_hash_table`, without copying it.
+ *
+ * @param image The table image, must outlive the table.
+ * @param size  The image size.
+ *
+ * @return A frozen hash table or NULL if the image is not valid.
+ *
+ */
+frozen_hash_table_t load_frozen_hash_table(const void *image, size_t size){
+    const frozen_header_t *header = (const frozen_header_t *) image;
+
+    if ((size < sizeof(frozen_header_t))
+        || (memcmp(header->magic, FROZEN_MAGIC, sizeof(header->magic)) != 0)
+        || (header->version != FROZEN_VERSION)
+        || (header->hash_check != _hash_check())
+        || (header->bucket_count == 0)
+        || (header->count > UINT32_MAX)
+        || (header->bucket_count > header->count + 1)
+        || (header->blob_size > UINT32_MAX)
+        || (_image_size(header->count, header->bucket_count,
+                        header->blob_size) != size)){
+        return NULL;
+    }
+
+    frozen_hash_table_t table = malloc(sizeof(struct frozen_hash_table));
+    assert(table != NULL);
+
+    table->owned_image = NULL;
+    table->image_size = size;
+    _map_image(table, image);
+
+    if (!_check_image(table)){
+        free(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+
+/**
+ * Description: Builds a hash table with the contents of a frozen one.
+ *
+ * @param table The frozen hash table.
+ *
+ * @return A new hash table.
+ *
+ */
+hash_table_t thaw_hash_table(frozen_hash_table_t table){
+    hash_table_t thawed = create_hash_table_with_size(
+        (frozen_hash_table_count(table) * 8) / 7 + 1);
+    size_t i;
+
+    for (i = 0; i < frozen_hash_table_count(table); i++){
+        const char *key;
+        size_t len;
+        void *value = frozen_hash_table_entry(table, i, &key, &len);
+
+        insert_hash_table_n(thawed, key, len, value);
+    }
+
+    return thawed;
+}
+
+
+/**
+ * Description: Frees a frozen hash table.
+ *
+ * @param table The frozen table to be freed.
+ *
+ */
+void free_frozen_hash_table(frozen_hash_table_t table){
+    if (table != NULL){
+        free(table->owned_image);
+    }
+
+    free(table);
+}
+
+
+/* Frozen table lookup */
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash in the frozen table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_frozen_hash_n`.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table_prehashed(frozen_hash_table_t table, const char *s,
+                                      size_t len, frozen_hash_t hash){
+
+    const frozen_header_t *header = table->header;
+    uint32_t f1, f2, bucket;
+
+    if (header->count == 0){
+        return NULL;
+    }
+
+    _split_hash(_seeded_hash(hash, header->seed), header->count,
+                header->bucket_count, &f1, &f2, &bucket);
+
+    uint64_t d0 = table->displacements[2 * bucket];
+    uint64_t d1 = table->displacements[2 * bucket + 1];
+    size_t pos = (f1 + d0 * f2 + d1) % header->count;
+
+    uint32_t offset = table->offsets[pos];
+    if (((table->offsets[pos + 1] - offset) != len)
+        || (memcmp(&table->blob[offset], s, len) != 0)){
+        return NULL;
+    }
+
+    return (void *) (uintptr_t) table->values[pos];
+}
+
+
+/**
+ * Description: Obtains the value associated with a string of known length
+ * in the frozen table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table_n(frozen_hash_table_t table, const char *s,
+                              size_t len){
+
+    return get_frozen_hash_table_prehashed(table, s, len,
+                                           get_frozen_hash_n(s, len));
+}
+
+
+/**
+ * Description: Obtains the value associated with a string in the frozen
+ * table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table(frozen_hash_table_t table, const char *s){
+    if (s == NULL){
+        return NULL;
+    }
+
+    return get_frozen_hash_table_n(table, s, strlen(s));
+}
+
+
+/**
+ * Description: Returns the number of keys in the frozen table.
+ *
+ * @param table The frozen table.
+ *
+ * @return The number of keys.
+ *
+ */
+size_t frozen_hash_table_count(frozen_hash_table_t table){
+    return table->header->count;
+}
+
+
+/**
+ * Description: Obtains the n-th (key, value) pair of the frozen table.
+ *
+ * @param table The frozen table.
+ * @param index The pair index, below `frozen_hash_table_count`.
+ * @param key   Receives the key (not '\0' ended).
+ * @param len   Receives the key length.
+ *
+ * @return The value.
+ *
+ */
+void *frozen_hash_table_entry(frozen_hash_table_t table, size_t index,
+                              const char **key, size_t *len){
+
+    assert(index < table->header->count);
+
+    *key = &table->blob[table->offsets[index]];
+    *len = table->offsets[index + 1] - table->offsets[index];
+
+    return (void *) (uintptr_t) table->values[index];
+}
+
+
+/* Serialization */
+/**
+ * Description: Returns the size of the frozen table image.
+ *
+ * @param table The frozen table.
+ *
+ * @return The image size in bytes.
+ *
+ */
+size_t frozen_hash_table_size(frozen_hash_table_t table){
+    return table->image_size;
+}
+
+
+/**
+ * Description: Writes the frozen table image to a file.
+ *
+ * @param table The frozen table.
+ * @param f     The file to write to.
+ *
+ * @return 1 on success, 0 on write errors.
+ *
+ */
+int write_frozen_hash_table(frozen_hash_table_t table, FILE *f){
+    return fwrite(table->header, 1, table->image_size, f) == table->image_size;
+}
+
+
+#endif
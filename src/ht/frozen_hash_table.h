@@ -0,0 +1,194 @@
+#ifndef FROZEN_HASH_TABLE_H
+#define FROZEN_HASH_TABLE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+
+/**
+ * @file frozen_hash_table.h
+ *
+ * @brief Immutable string indexed table.
+ * A read-only copy of a hash_table_t indexed by a minimal perfect hash
+ *  (CHD, "compress, hash and displace"): every key maps to its own slot,
+ *  so a lookup is one hash, one probe and one key comparison.
+ *
+ * The table is a single position independent image (keys packed in one
+ *  blob, values in a parallel array) that can be written to a file and
+ *  used straight from a mapping of it. Images are only valid for builds
+ *  with the same `HASH_FUNCTION`.
+ *
+ */
+
+/**
+ * Frozen hash table datatype.
+ *
+ */
+struct frozen_hash_table;
+typedef struct frozen_hash_table *frozen_hash_table_t;
+
+
+/**
+ * Frozen table key hash datatype, the same hash as `get_hash_n`.
+ *
+ */
+typedef hash_t frozen_hash_t;
+
+
+/* Hashing */
+/**
+ * Description: Returns the key hash of a string of known length.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+frozen_hash_t get_frozen_hash_n(const char *s, size_t len);
+
+
+/* Frozen table creation/freeing */
+/**
+ * Description: Builds a frozen copy of a hash table.
+ *
+ * @param table The hash table to freeze, values are stored as integers.
+ *
+ * @return A frozen hash table or NULL if out of memory.
+ *
+ */
+frozen_hash_table_t freeze_hash_table(hash_table_t table);
+
+
+/**
+ * Description: Uses a frozen table image, as written by
+ * `write_frozen_hash_table`, without copying it.
+ *
+ * @param image The table image, must outlive the table.
+ * @param size  The image size.
+ *
+ * @return A frozen hash table or NULL if the image is not valid, or was
+ *         written by a build with another hash function.
+ *
+ */
+frozen_hash_table_t load_frozen_hash_table(const void *image, size_t size);
+
+
+/**
+ * Description: Builds a hash table with the contents of a frozen one.
+ *
+ * @param table The frozen hash table.
+ *
+ * @return A new hash table.
+ *
+ */
+hash_table_t thaw_hash_table(frozen_hash_table_t table);
+
+
+/**
+ * Description: Frees a frozen hash table.
+ *
+ * @param table The frozen table to be freed.
+ *
+ */
+void free_frozen_hash_table(frozen_hash_table_t table);
+
+
+/* Frozen table lookup */
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash in the frozen table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_frozen_hash_n`.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table_prehashed(frozen_hash_table_t table, const char *s,
+                                      size_t len, frozen_hash_t hash);
+
+
+/**
+ * Description: Obtains the value associated with a string of known length
+ * in the frozen table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table_n(frozen_hash_table_t table, const char *s,
+                              size_t len);
+
+
+/**
+ * Description: Obtains the value associated with a string in the frozen
+ * table.
+ *
+ * @param table The frozen table to lookup in.
+ * @param s     The key string.
+ *
+ * @return The value or NULL if not found.
+ *
+ */
+void *get_frozen_hash_table(frozen_hash_table_t table, const char *s);
+
+
+/**
+ * Description: Returns the number of keys in the frozen table.
+ *
+ * @param table The frozen table.
+ *
+ * @return The number of keys.
+ *
+ */
+size_t frozen_hash_table_count(frozen_hash_table_t table);
+
+
+/**
+ * Description: Obtains the n-th (key, value) pair of the frozen table.
+ *
+ * @param table The frozen table.
+ * @param index The pair index, below `frozen_hash_table_count`.
+ * @param key   Receives the key (not '\0' ended).
+ * @param len   Receives the key length.
+ *
+ * @return The value.
+ *
+ */
+void *frozen_hash_table_entry(frozen_hash_table_t table, size_t index,
+                              const char **key, size_t *len);
+
+
+/* Serialization */
+/**
+ * Description: Returns the size of the frozen table image.
+ *
+ * @param table The frozen table.
+ *
+ * @return The image size in bytes.
+ *
+ */
+size_t frozen_hash_table_size(frozen_hash_table_t table);
+
+
+/**
+ * Description: Writes the frozen table image to a file.
+ *
+ * @param table The frozen table.
+ * @param f     The file to write to.
+ *
+ * @return 1 on success, 0 on write errors.
+ *
+ */
+int write_frozen_hash_table(frozen_hash_table_t table, FILE *f);
+
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef HASH_C
+#define HASH_C
+
+#include <string.h>
+
+#include "hash.h"
+
+/**
+ * @file hash.c
+ *
+ * @brief String hash functions implementation.
+ *
+ * wy_hash follows Wang Yi's wyhash (public domain): keys up to 16 bytes
+ * are read as two overlapping 8 byte words, longer ones are folded 16
+ * bytes per round, and every round is a 128 bit multiply whose halves are
+ * xored. Dictionary words cost one or two multiplies instead of a few
+ * dependent shifts and adds per byte.
+ *
+ */
+
+/**
+ * wyhash secret (default seed constants).
+ *
+ */
+#define WY_P0 0xa0761d6478bd642fUL
+#define WY_P1 0xe7037ed1a0b428dbUL
+
+
+/**
+ * Description: Multiplies two words to 128 bits and folds the halves.
+ *
+ */
+static inline uint64_t _wy_mix(uint64_t a, uint64_t b){
+    unsigned __int128 r = (unsigned __int128) a * b;
+
+    return ((uint64_t) r) ^ ((uint64_t) (r >> 64));
+}
+
+
+static inline uint64_t _read_64(const unsigned char *p){
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+
+static inline uint64_t _read_32(const unsigned char *p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+
+/**
+ * Description: Hashes a string 8 bytes at a time with 64x64->128 bit
+ * multiply-mix rounds (wyhash).
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t wy_hash(const char *s, size_t len){
+    const unsigned char *p = (const unsigned char *) s;
+    uint64_t seed = _wy_mix(WY_P0, WY_P1);
+    uint64_t a, b;
+
+    if (len <= 16){
+        if (len >= 4){
+            size_t middle = (len >> 3) << 2;
+
+            a = (_read_32(p) << 32) | _read_32(p + middle);
+            b = (_read_32(p + len - 4) << 32) | _read_32(p + len - 4 - middle);
+        }
+        else if (len > 0){
+            a = (((uint64_t) p[0]) << 16) | (((uint64_t) p[len >> 1]) << 8)
+                | p[len - 1];
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = len;
+
+        while (i > 16){
+            seed = _wy_mix(_read_64(p) ^ WY_P1, _read_64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = _read_64(p + i - 16);
+        b = _read_64(p + i - 8);
+    }
+
+    unsigned __int128 r = (unsigned __int128) (a ^ WY_P1) * (b ^ seed);
+
+    return _wy_mix(((uint64_t) r) ^ WY_P0 ^ len,
+                   ((uint64_t) (r >> 64)) ^ WY_P1);
+}
+
+
+/**
+ * Description: Hashes a string a byte at a time with Jenkins'
+ * One-at-a-Time, on 64 bit arithmetic.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t one_at_a_time_hash(const char *s, size_t len){
+    hash_t h = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++){
+        h += (unsigned char) s[i];
+        h += ( h << 10 );
+        h ^= ( h >> 6 );
+    }
+
+    h += ( h << 3 );
+    h ^= ( h >> 11 );
+    h += ( h << 15 );
+
+    return h;
+}
+
+
+/**
+ * Description: Hashes a string a byte at a time with 64 bit FNV-1a.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t fnv1a_hash(const char *s, size_t len){
+    hash_t h = 0xcbf29ce484222325UL;
+    size_t i;
+
+    for (i = 0; i < len; i++){
+        h = (h ^ (unsigned char) s[i]) * 0x100000001b3UL;
+    }
+
+    return h;
+}
+
+
+/**
+ * Description: Returns the hash associated to an string.
+ *
+ * @param s The string to be hashed.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t get_hash(const char *s){
+    return HASH_FUNCTION(s, strlen(s));
+}
+
+
+/**
+ * Description: Returns the hash associated to a string of known length.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t get_hash_n(const char *s, size_t len){
+    return HASH_FUNCTION(s, len);
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file hash.h
+ *
+ * @brief String hash functions.
+ * The hash shared by the string indexed tables, and the alternatives it
+ *  was chosen among. Every function returns 64 well mixed bits, tables
+ *  take slots from the low bits (masking a power of two capacity) and
+ *  shards or filter blocks from the high ones.
+ *
+ */
+
+/**
+ * Hash datatype.
+ *
+ */
+typedef uint64_t hash_t;
+
+
+/**
+ * Hash function datatype, hashes `len` bytes of `s`.
+ *
+ */
+typedef hash_t (*hash_function_t)(const char *s, size_t len);
+
+
+/**
+ * @note Hash used by `get_hash` and `get_hash_n`, so by all the tables.
+ *       Build with -DHASH_FUNCTION=<function> to replace it.
+ *
+ */
+#ifndef HASH_FUNCTION
+    #define HASH_FUNCTION wy_hash
+#endif
+
+
+/* Hash functions */
+/**
+ * Description: Hashes a string 8 bytes at a time with 64x64->128 bit
+ * multiply-mix rounds (wyhash).
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t wy_hash(const char *s, size_t len);
+
+
+/**
+ * Description: Hashes a string a byte at a time with Jenkins'
+ * One-at-a-Time, on 64 bit arithmetic.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t one_at_a_time_hash(const char *s, size_t len);
+
+
+/**
+ * Description: Hashes a string a byte at a time with 64 bit FNV-1a.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t fnv1a_hash(const char *s, size_t len);
+
+
+/**
+ * Description: Returns the hash associated to an string.
+ *
+ * @param s The string to be hashed.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t get_hash(const char *s);
+
+
+/**
+ * Description: Returns the hash associated to a string of known length.
+ *
+ * @param s   The string to be hashed.
+ * @param len The string length.
+ *
+ * @return The associated hash to s.
+ *
+ */
+hash_t get_hash_n(const char *s, size_t len);
+
+#endif
@@ -3,30 +3,50 @@
 
 #include "hash_table.h"
 
+#define ALLOC_MODULE ALLOC_HASH_TABLE
+#include "alloc_stats.h"
+
 /**
  * @file hash_table.c
  *
  * @brief Almost Ansi C hash table implementation.
  *
- * An ANSI C implementation of a hash table  allowing to use integers and
- * '\0' ended strings as index.
+ * An ANSI C implementation of a hash table allowing to use '\0' ended
+ * strings as index.
+ *
+ * Collisions are resolved with Robin Hood open addressing: every slot keeps
+ * the key hash and its distance to the slot the hash points to, so probes
+ * compare hashes in a contiguous array and only touch the key string when
+ * the hashes match. Key strings are copied to an arena, owned by the table
+ * unless it was given one.
  *
- * @note Uses One-at-a-Time hash algorithm for strings.
+ * @note Hashes keys with `get_hash_n` (see hash.h). Slots keep the low 32
+ *       bits of the hash, enough to find the home slot and to skip most key
+ *       comparisons, so a slot still fits in 32 bytes.
  *
- * @todo Assert mallocs
  */
 
 /**
- * Implementation specific data types
- * (internal structure for hash collisions).
+ * Implementation specific data types.
+ */
+
+/**
+ * Maximum load (out of 256) before the table grows.
+ *
  */
+#define HASH_TABLE_MAX_LOAD 224
+
 
 /**
- * Hash table node structure.
+ * Hash table slot structure.
  *
  */
-struct hash_table_node{
-    void * string_indexed;
+struct hash_table_slot{
+    unsigned int hash; /* low bits of the key hash */
+    unsigned int distance; /* probe distance + 1, 0 for empty slots */
+    size_t length;
+    char *key;
+    void *value;
 };
 
 
@@ -35,252 +55,287 @@ struct hash_table_node{
  *
  */
 struct hash_table{
-    int size;
-    hash_table_node_t **fields;
-    llist_t *str_keys;
+    size_t capacity; /* always a power of two */
+    size_t count;
+    hash_table_slot_t *slots;
+    arena_t *keys;
+    int owns_keys;
 };
 
 
+/* Hash table creation/freeing */
 /**
- * String indexed tree.
+ * Description: Returns a hash table.
+ *
+ * @return A hash table.
+ *
  */
-typedef struct str_tree_node{
-    struct str_tree_node * left;
-    struct str_tree_node * right;
-    ///int height;
-    hash_t full_hash; /* is faster to check the hash (precalculated) than the
-                       * entire string */
-
-    //llist_node_t *key;
-    char * index;
-    void * value;
+hash_table_t create_hash_table(){
+    return create_hash_table_with_size(DEFAULT_HASH_TABLE_SIZE);
+}
 
-}str_tree_node_t;
 
 /**
- *  Hashing code
- *  Returns the hash for a given variable using
- *  "One at a time hash".
- */
-/**
- * Description: Returns the hash associated to an string.
+ * Description: Allocates the slots for a hash table.
  *
- * @param s The string to be hashed.
+ * @param capacity The number of slots, a power of two.
  *
- * @return The associated hash to s.
+ * @return The empty slots.
  *
  */
-hash_t get_hash(char *s){
-    hash_t h = 0;
-    int i;
-
-    for (i = 0; s[i] != '\0'; i++ ){
-        h += s[i];
-        h += ( h << 10 );
-        h ^= ( h >> 6 );
-    }
-
-    h += ( h << 3 );
-    h ^= ( h >> 11 );
-    h += ( h << 15 );
+hash_table_slot_t *_create_hash_table_slots(size_t capacity){
+    hash_table_slot_t *slots = (hash_table_slot_t *)
+                                 calloc(capacity, sizeof(hash_table_slot_t));
+    assert(slots != NULL);
 
-    return h;
+    return slots;
 }
 
 
-/* Hash table creation/freeing */
 /**
- * Description: Returns a hash table.
+ * Description: Returns a hash table with the specified size.
+ *
+ * @note The size is rounded up to a power of two, the table grows when
+ *       it gets full.
  *
  * @return A hash table.
  *
  */
-hash_table_t create_hash_table(){
-    return create_hash_table_with_size(DEFAULT_HASH_TABLE_SIZE);
+hash_table_t create_hash_table_with_size(int size){
+    arena_t *keys = create_arena(0);
+    assert(keys != NULL);
+
+    hash_table_t table = create_hash_table_with_arena(size, keys);
+    table->owns_keys = 1;
+
+    return table;
 }
 
 
 /**
- * Description: Returns a hash table with the specified size.
+ * Description: Returns a hash table that copies its keys to a shared
+ * arena. Freeing the table leaves the keys in the arena, so several tables
+ * (or other data) can be released at once with it.
  *
- * @note Hash table sizes should be prime numbers for better performance.
+ * @param size  The initial size, as in `create_hash_table_with_size`.
+ * @param arena The arena for the keys, must outlive the table.
  *
  * @return A hash table.
  *
  */
-hash_table_t create_hash_table_with_size(int size){
+hash_table_t create_hash_table_with_arena(int size, arena_t *arena){
     hash_table_t table = (hash_table_t) malloc(sizeof(struct hash_table));
     assert(table != NULL);
 
-    table->size = size;
-    table->fields = (hash_table_node_t **)
-                          malloc(size * sizeof(hash_table_node_t *));
-
-    assert(table->fields != NULL);
-
-    if (NULL == 0){
-        bzero(table->fields, sizeof(hash_table_node_t *) * size);
-    }
-    else{
-        int i;
-        for (i = 0;i < size;i++){
-            table->fields[(unsigned int) i] = NULL;
-        }
+    table->capacity = 16;
+    while ((int) table->capacity < size){
+        table->capacity *= 2;
     }
 
-    table->str_keys = create_llist();
-    assert(table->str_keys != NULL);
+    table->count = 0;
+    table->slots = _create_hash_table_slots(table->capacity);
+    table->keys = arena;
+    table->owns_keys = 0;
 
     return table;
 }
 
 
 /**
- * Description: Frees a node from the internal string indexed
- * binary tree.
+ * Description: Frees a hash table.
  *
- * @param node The binary tree node to be freed.
+ * @param table The hash table to be freed.
  * @param free_content_f A function to free the values (NULL for none).
- * @param free_str_index_f A function to free the index (NULL for none).
  *
  */
-void free_str_index_tree(str_tree_node_t * node,
-                         void (* free_content_f) (void *)){
+void free_hash_table(hash_table_t table,
+                     void (* free_content_f) (void *)) {
 
-    if (node != NULL){
-        free_str_index_tree(node->right, free_content_f);
-        free_str_index_tree(node->left,  free_content_f);
+    if(table == NULL){
+        return ;
+    }
 
-        free(node->index);
+    size_t i;
 
-        if (free_content_f != NULL){
-            free_content_f(node->value);
+    if (free_content_f != NULL){
+        for (i = 0; i < table->capacity; i++){
+            if (table->slots[i].distance != 0){
+                free_content_f(table->slots[i].value);
+            }
         }
+    }
+    free(table->slots);
 
-        free(node);
+    if (table->owns_keys){
+        free_arena(table->keys);
     }
+
+    free(table);
 }
 
 
+/* Hash table manipulation */
 /**
- * Description: Frees a node from the hash table.
+ * Description: Copies a key to the table arena.
  *
- * @param node The binary tree node to be freed.
- * @param free_content_f A function to free the values (NULL for none).
- * @param free_str_index_f A function to free
- *                         the string indexes (NULL for none).
+ * @param table The hash table owning the key.
+ * @param s     The key.
+ * @param len   The key length.
+ *
+ * @return The '\0' ended copy of the key.
  *
  */
-void free_hash_table_node(hash_table_node_t * node,
-                          void (* free_content_f) (void *)){
-
-    assert(node != NULL);
-
+char *_copy_hash_table_key(hash_table_t table, const char *s, size_t len){
+    char *copy = arena_strndup(table->keys, s, len);
+    assert(copy != NULL);
 
-    free_str_index_tree((str_tree_node_t *)node->string_indexed,
-                        free_content_f);
-
-    free(node);
+    return copy;
 }
 
 
 /**
- * Description: Frees a hash table.
+ * Description: Places a slot in the table, displacing the slots closer to
+ * their home position (Robin Hood).
  *
- * @param table The hash table to be freed.
- * @param free_content_f A function to free the values (NULL for none).
- * @param free_str_index_f A function to free.
- *                         the string indexes (NULL for none).
+ * @param slots    The table slots.
+ * @param capacity The number of slots.
+ * @param slot     The slot to be placed, its distance must be 1.
  *
  */
-void free_hash_table(hash_table_t table,
-                     void (* free_content_f) (void *)) {
+void _place_hash_table_slot(hash_table_slot_t *slots, size_t capacity,
+                            hash_table_slot_t slot){
 
-    if(table == NULL){
-        return ;
+    size_t mask = capacity - 1;
+    size_t i = slot.hash & mask;
+
+    while (slots[i].distance != 0){
+        if (slots[i].distance < slot.distance){
+            hash_table_slot_t displaced = slots[i];
+            slots[i] = slot;
+            slot = displaced;
+        }
+
+        slot.distance++;
+        i = (i + 1) & mask;
     }
 
-    hash_table_node_t *node;
-    int i;
+    slots[i] = slot;
+}
 
-    free_llist(table->str_keys, NULL);
 
-    for (i = 0;i < table->size; i++){
-        node = table->fields[(unsigned int) i];
-        if (node != NULL){
-            free_hash_table_node(node, free_content_f);
+/**
+ * Description: Doubles the number of slots of a table.
+ *
+ * @param table The hash table to grow.
+ *
+ */
+void _grow_hash_table(hash_table_t table){
+    size_t capacity = table->capacity * 2;
+    hash_table_slot_t *slots = _create_hash_table_slots(capacity);
+    size_t i;
+
+    for (i = 0; i < table->capacity; i++){
+        if (table->slots[i].distance != 0){
+            hash_table_slot_t slot = table->slots[i];
+            slot.distance = 1;
+
+            _place_hash_table_slot(slots, capacity, slot);
         }
     }
-    free(table->fields);
 
-    free(table);
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
 }
 
 
-/* Hash table manipulation */
 /**
- * Description: Creates a hash table node.
+ * Description: Finds the slot holding a key.
  *
- * @param hash The hash asociated to the node.
+ * @param table The hash table to lookup in.
+ * @param s     The key string.
+ * @param len   The key length.
+ * @param hash  The key hash.
  *
- * @return A pointer to a hash_table_node_t with the specified hash and
- *          NULLed 'left', 'right', 'integer_indexed', 'string_indexed'.
+ * @return The slot holding the key or NULL if not found.
  *
  */
-hash_table_node_t * create_hash_table_node(hash_t hash){
+hash_table_slot_t *_find_hash_table_slot(hash_table_t table,
+                                         const char *s, size_t len,
+                                         unsigned int hash){
+
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    unsigned int distance = 1;
 
-    hash_table_node_t * node = (hash_table_node_t*)
-                                malloc(sizeof(hash_table_node_t));
+    /* Past a slot closer to its home than us the key can't be found */
+    while (table->slots[i].distance >= distance){
+        if ((table->slots[i].hash == hash)
+            && (table->slots[i].length == len)
+            && (memcmp(table->slots[i].key, s, len) == 0)){
+
+            return &table->slots[i];
+        }
 
-    node->string_indexed  = NULL;
+        distance++;
+        i = (i + 1) & mask;
+    }
 
-    return node;
+    return NULL;
 }
 
 
 /**
- * Description: Inserts a hash table node in a hash table or returns
- * the one with the associated hash.
+ * Description: Inserts a value indexed by a string of known length and
+ * hash into the hash table.
  *
  * @param table The hash table to lookup in.
- * @param hash  The associated hash to the node.
- *
- * @return A pointer to a hash_table_node_t.
+ * @param s     The table index.
+ * @param len   The index length.
+ * @param hash  The index hash, as returned by `get_hash_n`.
+ * @param v     The value to insert.
  *
  */
-hash_table_node_t * _insert_hash_table_node(hash_table_t table, hash_t hash){
+void insert_hash_table_prehashed(hash_table_t table, const char *s, size_t len,
+                                 hash_t hash, void *v){
 
-    hash_table_node_t * node = table->fields[(unsigned int) hash % table->size];
+    hash_table_slot_t *found = _find_hash_table_slot(table, s, len, hash);
 
-    if (node == NULL){
-        node = table->fields[(unsigned int) hash % table->size] = create_hash_table_node(hash);
+    if (found != NULL){
+        // Found, overwrite
+        found->value = v;
     }
+    else {
+        if (((table->count + 1) * 256) > (table->capacity * HASH_TABLE_MAX_LOAD)){
+            _grow_hash_table(table);
+        }
 
-    return node;
+        hash_table_slot_t slot = {
+            .hash = hash,
+            .distance = 1,
+            .length = len,
+            .key = _copy_hash_table_key(table, s, len),
+            .value = v,
+        };
+
+        _place_hash_table_slot(table->slots, table->capacity, slot);
+        table->count++;
+    }
 }
 
 
 /**
- * Description: creates a string indexed binary tree node.
- *
- * @param s The node index.
- * @param v The node value.
+ * Description: Inserts a value indexed by a string of known length into
+ * the hash table.
  *
- * @return A pointer to the str_tree_node_t.
+ * @param table The hash table to lookup in.
+ * @param s     The table index.
+ * @param len   The index length.
+ * @param v     The value to insert.
  *
  */
-str_tree_node_t * _make_str_tree_node(char *s, void *v){
-    str_tree_node_t * node = (str_tree_node_t *)
-                                     malloc(sizeof(str_tree_node_t));
-
-    node->left = NULL;
-    node->right = NULL;
-    node->full_hash = get_hash(s);
-    ///node->height = 0;
-    node->index = strdup(s);
-    node->value = v;
-
-    return node;
+void insert_hash_table_n(hash_table_t table, const char *s, size_t len, void *v){
+    insert_hash_table_prehashed(table, s, len, get_hash_n(s, len), v);
 }
 
 
@@ -293,98 +348,48 @@ str_tree_node_t * _make_str_tree_node(char *s, void *v){
  *
  */
 void insert_hash_table(hash_table_t table, char *s, void *v){
+    insert_hash_table_n(table, s, strlen(s), v);
+}
 
-    int i, done = 0;
-    hash_t hash = get_hash(s);
-
-    hash_table_node_t * rnode =
-                  _insert_hash_table_node(table, hash);
-
-    str_tree_node_t * node = (str_tree_node_t *)
-                                            rnode->string_indexed;
-
-    if (node == NULL){
-        node = _make_str_tree_node(s, v);
-
-        rnode->string_indexed = node;
-
-    }
-
-    else{
-        /** @todo refactor with preprocessor ? */
-        while(!done){
-            /* Position lookup */
-            if (hash < node->full_hash){
-                if (node->left == NULL){
-                    node->left = _make_str_tree_node(s, v);
-                    done = 1;
-                }
-
-                else{
-                    node = node->left;
-                }
-            }
 
-            else if (hash > node->full_hash){
-                if (node->right == NULL){
-                    node->right = _make_str_tree_node(s, v);
-                    done = 1;
-                }
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash in the hash table.
+ *
+ * @param table The hash table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ *
+ * @return The inserted value or NULL if not found.
+ *
+ */
+void *get_hash_table_prehashed(hash_table_t table, const char *s, size_t len,
+                               hash_t hash){
 
-                else{
-                    node = node->right;
-                }
-            }
+    hash_table_slot_t *slot = _find_hash_table_slot(table, s, len, hash);
 
-            else{
-                i = strcmp(s, node->index);
-                if (i < 0){
-                    if (node->left == NULL){
-                        node->left = _make_str_tree_node(s, v);
-                        done = 1;
-                    }
-
-                    else{
-                        node = node->left;
-                    }
-                }
-
-                else if (i > 0){
-                    if (node->right == NULL){
-                        node->right = _make_str_tree_node(s, v);
-                        done = 1;
-                    }
-
-                    else{
-                        node = node->right;
-                    }
-                }
-
-                else{
-                    // Found, overwrite
-                    node->value = v;
-                    done = 1; /* <uncomment /> */
-                }
-            }
-        }
+    if (slot == NULL){
+        return NULL;
     }
 
-    add_to_llist(table->str_keys, s);
+    return slot->value;
 }
 
 
 /**
- * Description: Obtains the hash table node associated with a hash.
+ * Description: Obtains the value associated with a string of known length
+ * in the hash table.
  *
  * @param table The hash table to lookup in.
- * @param hash  The target hash.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
  *
- * @return A pointer to the hash_table_node_t associated with the hash.
+ * @return The inserted value or NULL if not found.
  *
  */
-hash_table_node_t *_get_values_for_hash(hash_table_t table, hash_t hash){
-
-    return table->fields[(unsigned int) hash % table->size];
+void *get_hash_table_n(hash_table_t table, const char *s, size_t len){
+    return get_hash_table_prehashed(table, s, len, get_hash_n(s, len));
 }
 
 
@@ -402,48 +407,91 @@ void *get_hash_table(hash_table_t table, char *s){
         return NULL;
     }
 
-    hash_t hash = get_hash(s);
-    hash_table_node_t * rnode = _get_values_for_hash(table, hash);
+    return get_hash_table_n(table, s, strlen(s));
+}
 
-    if (rnode == NULL){
-        return NULL;
-    }
-    if (rnode->string_indexed == NULL){
-        return NULL;
-    }
 
-    str_tree_node_t *node = (str_tree_node_t*)
-                                        rnode->string_indexed;
+/**
+ * Description: Returns the number of keys in the table.
+ *
+ * @param table The hash table.
+ *
+ * @return The number of distinct keys inserted.
+ *
+ */
+size_t hash_table_count(hash_table_t table){
+    assert(table != NULL);
+    return table->count;
+}
 
-    int i = 1;
 
-    while ((node != NULL) && (i != 0)){
-        if (hash < node->full_hash){
-            node = node->left;
-        }
+/* Hash table iteration */
+/**
+ * Description: Returns an iterator over the (key, value) pairs of a table.
+ *
+ * @param table The hash table to walk.
+ *
+ * @return An iterator positioned before the first pair.
+ *
+ */
+hash_table_iterator_t hash_table_iterator(hash_table_t table){
+    assert(table != NULL);
 
-        else if (hash > node->full_hash){
-            node = node->right;
-        }
+    hash_table_iterator_t it = { table, 0 };
+    return it;
+}
 
-        else{
-            i = strcmp(s, node->index);
 
-            if (i < 0){
-                node = node->left;
-            }
+/**
+ * Description: Advances an iterator to the next (key, value) pair.
+ *
+ * @param it    The iterator.
+ * @param key   Receives the key, owned by the table (NULL to skip it).
+ * @param value Receives the value (NULL to skip it).
+ *
+ * @return 1 if a pair was read, 0 at the end of the table.
+ *
+ */
+int hash_table_next(hash_table_iterator_t *it, const char **key, void **value){
+    const hash_table_slot_t *slots = it->table->slots;
+
+    while (it->position < it->table->capacity){
+        const hash_table_slot_t *slot = &slots[it->position++];
 
-            else if (i > 0){
-                node = node->right;
+        if (slot->distance != 0){
+            if (key != NULL){
+                *key = slot->key;
             }
+            if (value != NULL){
+                *value = slot->value;
+            }
+            return 1;
         }
     }
 
-    if (node == NULL){
-        return NULL;
-    }
+    return 0;
+}
+
 
-    return node->value;
+/**
+ * Description: Calls a function for every (key, value) pair in the table.
+ *
+ * @param table The hash table to walk.
+ * @param f     The function to call, receives the key, the value and `data`.
+ * @param data  Extra argument passed to `f`.
+ *
+ */
+void foreach_hash_table(hash_table_t table,
+                        void (* f) (const char *, void *, void *),
+                        void *data){
+
+    hash_table_iterator_t it = hash_table_iterator(table);
+    const char *key;
+    void *value;
+
+    while (hash_table_next(&it, &key, &value)){
+        f(key, value, data);
+    }
 }
 
 
@@ -452,12 +500,20 @@ void *get_hash_table(hash_table_t table, char *s){
  *
  * @param table The hash table to lookup in.
  *
- * @return The linked list of the string keys.
+ * @return A new vector of the string keys, the keys are owned by the
+ *         table. Free it with `free_vector(keys, NULL)`.
  *
  */
-llist_t *get_hash_table_str_keys(hash_table_t table){
-    assert(table != NULL);
-    return (table->str_keys);
+vector_t *get_hash_table_str_keys(hash_table_t table){
+    hash_table_iterator_t it = hash_table_iterator(table);
+    vector_t *keys = create_vector_with_capacity(table->count);
+    const char *key;
+
+    while (hash_table_next(&it, &key, NULL)){
+        add_to_vector(keys, (void *) key);
+    }
+
+    return keys;
 }
 
 
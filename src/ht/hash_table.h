@@ -5,7 +5,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+#include "hash.h"
 #include "linked_list.h"
+#include "vector.h"
 /**
  * @file hash_table.h
  *
@@ -20,18 +23,11 @@
  *
  */
 /**
- * Hash (table index) datatype.
+ * Hash table slot datatype.
  *
  */
-typedef int hash_t;
-
-
-/**
- * Hash table node datatype.
- *
- */
-struct hash_table_node;
-typedef struct hash_table_node hash_table_node_t;
+struct hash_table_slot;
+typedef struct hash_table_slot hash_table_slot_t;
 
 
 /**
@@ -43,24 +39,24 @@ typedef struct hash_table *hash_table_t;
 
 
 /**
- * @note Hash table size should be a prime number for better performance.
+ * Hash table iterator datatype.
+ *
+ * @note Inserting new keys invalidates the iterators of a table.
  *
  */
-#ifndef DEFAULT_HASH_TABLE_SIZE
-    #define DEFAULT_HASH_TABLE_SIZE 1021
-#endif
+typedef struct {
+    hash_table_t table;
+    size_t position;
+} hash_table_iterator_t;
 
 
-/* Hashing */
 /**
- * Description: Returns the hash associated to an string.
- *
- * @param s The string to be hashed.
- *
- * @return The associated hash to s.
+ * @note Initial number of slots, tables grow as needed.
  *
  */
-hash_t get_hash(char *s);
+#ifndef DEFAULT_HASH_TABLE_SIZE
+    #define DEFAULT_HASH_TABLE_SIZE 1021
+#endif
 
 
 /**
@@ -79,7 +75,8 @@ hash_table_t create_hash_table();
 /**
  * Description: Returns a hash table with the specified size.
  *
- * @note Hash table sizes should be prime numbers for better performance.
+ * @note The size is rounded up to a power of two, the table grows when
+ *       it gets full.
  *
  * @return A hash table.
  *
@@ -87,6 +84,20 @@ hash_table_t create_hash_table();
 hash_table_t create_hash_table_with_size(int size);
 
 
+/**
+ * Description: Returns a hash table that copies its keys to a shared
+ * arena. Freeing the table leaves the keys in the arena, so several tables
+ * (or other data) can be released at once with it.
+ *
+ * @param size  The initial size, as in `create_hash_table_with_size`.
+ * @param arena The arena for the keys, must outlive the table.
+ *
+ * @return A hash table.
+ *
+ */
+hash_table_t create_hash_table_with_arena(int size, arena_t *arena);
+
+
 /**
  * Description: Frees a hash table.
  *
@@ -113,6 +124,34 @@ void free_hash_table(hash_table_t table,
 void insert_hash_table(hash_table_t table, char *s, void *v);
 
 
+/**
+ * Description: Inserts a value indexed by a string of known length into
+ * the hash table.
+ *
+ * @param table The hash table to lookup in.
+ * @param s     The table index.
+ * @param len   The index length.
+ * @param v     The value to insert.
+ *
+ */
+void insert_hash_table_n(hash_table_t table, const char *s, size_t len, void *v);
+
+
+/**
+ * Description: Inserts a value indexed by a string of known length and
+ * hash into the hash table.
+ *
+ * @param table The hash table to lookup in.
+ * @param s     The table index.
+ * @param len   The index length.
+ * @param hash  The index hash, as returned by `get_hash_n`.
+ * @param v     The value to insert.
+ *
+ */
+void insert_hash_table_prehashed(hash_table_t table, const char *s, size_t len,
+                                 hash_t hash, void *v);
+
+
 /**
  * Description: Obtains the value associated with a string in the hash table.
  *
@@ -125,15 +164,98 @@ void insert_hash_table(hash_table_t table, char *s, void *v);
 void *get_hash_table(hash_table_t table, char *s);
 
 
+/**
+ * Description: Obtains the value associated with a string of known length
+ * in the hash table.
+ *
+ * @param table The hash table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ *
+ * @return The inserted value or NULL if not found.
+ *
+ */
+void *get_hash_table_n(hash_table_t table, const char *s, size_t len);
+
+
+/**
+ * Description: Obtains the value associated with a string of known length
+ * and hash in the hash table.
+ *
+ * @param table The hash table to lookup in.
+ * @param s     The key string, doesn't need to be '\0' ended.
+ * @param len   The key length.
+ * @param hash  The key hash, as returned by `get_hash_n`.
+ *
+ * @return The inserted value or NULL if not found.
+ *
+ */
+void *get_hash_table_prehashed(hash_table_t table, const char *s, size_t len,
+                               hash_t hash);
+
+
+/**
+ * Description: Returns the number of keys in the table.
+ *
+ * @param table The hash table.
+ *
+ * @return The number of distinct keys inserted.
+ *
+ */
+size_t hash_table_count(hash_table_t table);
+
+
+/**
+ * Hash table iteration.
+ *
+ */
+/**
+ * Description: Returns an iterator over the (key, value) pairs of a table.
+ *
+ * @param table The hash table to walk.
+ *
+ * @return An iterator positioned before the first pair.
+ *
+ */
+hash_table_iterator_t hash_table_iterator(hash_table_t table);
+
+
+/**
+ * Description: Advances an iterator to the next (key, value) pair.
+ *
+ * @param it    The iterator.
+ * @param key   Receives the key, owned by the table (NULL to skip it).
+ * @param value Receives the value (NULL to skip it).
+ *
+ * @return 1 if a pair was read, 0 at the end of the table.
+ *
+ */
+int hash_table_next(hash_table_iterator_t *it, const char **key, void **value);
+
+
+/**
+ * Description: Calls a function for every (key, value) pair in the table.
+ *
+ * @param table The hash table to walk.
+ * @param f     The function to call, receives the key, the value and `data`.
+ * @param data  Extra argument passed to `f`.
+ *
+ */
+void foreach_hash_table(hash_table_t table,
+                        void (* f) (const char *, void *, void *),
+                        void *data);
+
+
 /**
  * Description: Obtains string key values of a hash table.
  *
  * @param table The hash table to lookup in.
  *
- * @return The linked list of the string keys.
+ * @return A new vector of the string keys, the keys are owned by the
+ *         table. Free it with `free_vector(keys, NULL)`.
  *
  */
-llist_t *get_hash_table_str_keys(hash_table_t table);
+vector_t *get_hash_table_str_keys(hash_table_t table);
 
 
 
@@ -3,6 +3,9 @@
 
 #include "linked_list.h"
 #include <assert.h>
+
+#define ALLOC_MODULE ALLOC_LINKED_LIST
+#include "alloc_stats.h"
 /**
  * @file linked_list.c
  * 
@@ -282,6 +285,8 @@ llist_t *merge_llists(llist_t *dst, llist_t *src){
     if (dst->first == NULL){
         dst->first = src->first;
     }
+
+    dst->size += src->size;
     
     free(src);
 
@@ -0,0 +1,174 @@
+#ifndef VECTOR_C
+#define VECTOR_C
+
+#include <string.h>
+
+#include "vector.h"
+
+#define ALLOC_MODULE ALLOC_VECTOR
+#include "alloc_stats.h"
+/**
+ * @file vector.c
+ *
+ * @brief Growable array implementation.
+ *
+ */
+
+/**
+ * Description: Creates a new, empty vector.
+ *
+ * @return A vector.
+ *
+ */
+vector_t *create_vector(){
+    return create_vector_with_capacity(DEFAULT_VECTOR_CAPACITY);
+}
+
+
+/**
+ * Description: Creates a new, empty vector with room for some elements.
+ *
+ * @param capacity The elements it can hold before growing.
+ *
+ * @return A vector.
+ *
+ */
+vector_t *create_vector_with_capacity(size_t capacity){
+    vector_t *v = (vector_t *) malloc(sizeof(vector_t));
+    assert(v != NULL);
+
+    if (capacity < 1){
+        capacity = 1;
+    }
+
+    v->size = 0;
+    v->capacity = capacity;
+    v->elements = (void **) malloc(sizeof(void *) * capacity);
+    assert(v->elements != NULL);
+
+    return v;
+}
+
+
+/**
+ * Description: Makes room for some elements, so appending up to that many
+ * doesn't move the buffer.
+ *
+ * @param vector   Vector.
+ * @param capacity The number of elements it must hold.
+ *
+ */
+void reserve_vector(vector_t *vector, size_t capacity){
+    if (capacity <= vector->capacity){
+        return;
+    }
+
+    vector->elements = (void **) realloc(vector->elements,
+                                         sizeof(void *) * capacity);
+    assert(vector->elements != NULL);
+
+    vector->capacity = capacity;
+}
+
+
+/**
+ * Description: Add a pointer to the end of a vector.
+ *
+ * @param vector  Vector.
+ * @param element The element to be added to the vector.
+ *
+ * @return The index of the added element.
+ *
+ */
+size_t add_to_vector(vector_t *vector, void *element){
+    if (vector->size == vector->capacity){
+        reserve_vector(vector, vector->capacity * 2);
+    }
+
+    vector->elements[vector->size] = element;
+
+    return vector->size++;
+}
+
+
+/**
+ * Description: Frees the memory of a vector.
+ *
+ * @param vector The vector to be freed.
+ * @param free_content A pointer to the function to remove
+ *                     the contents (or NULL for none).
+ *
+ */
+void free_vector(vector_t *vector, void (*free_content) (void *)){
+    if (vector == NULL){
+        return;
+    }
+
+    if (free_content != NULL){
+        size_t i;
+
+        for (i = 0; i < vector->size; i++){
+            free_content(vector->elements[i]);
+        }
+    }
+
+    free(vector->elements);
+    free(vector);
+}
+
+
+/**
+ * Description: merges two vectors. Appends `src` to `dst` and deletes
+ * `src` headers. The merged vector keeps whichever buffer already fits
+ * both, so merging into an empty or small vector takes over the buffer of
+ * `src` instead of copying it.
+ *
+ * @param dst Destination vector. Its elements will be first.
+ * @param src Source vector. Its elements will be last, and its headers
+ *              will be deleted.
+ *
+ * @return The merged vector.
+ *
+ */
+vector_t *merge_vectors(vector_t *dst, vector_t *src){
+    // NULL source
+    if (src == NULL){
+        return dst;
+    }
+
+    // NULL dest
+    if (dst == NULL){
+        return src;
+    }
+
+    size_t size = dst->size + src->size;
+
+    if ((size > dst->capacity) && (size <= src->capacity)){
+        // Steal the source buffer, making room for dst elements at its start
+        memmove(&src->elements[dst->size], src->elements,
+                sizeof(void *) * src->size);
+        memcpy(src->elements, dst->elements, sizeof(void *) * dst->size);
+
+        void **elements = dst->elements;
+        dst->elements = src->elements;
+        dst->capacity = src->capacity;
+        src->elements = elements;
+    }
+    else {
+        if (size > dst->capacity){
+            reserve_vector(dst, size);
+        }
+        memcpy(&dst->elements[dst->size], src->elements,
+               sizeof(void *) * src->size);
+    }
+
+    dst->size = size;
+
+    free(src->elements);
+    free(src);
+
+    return dst;
+}
+
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <assert.h>
+#include <stdlib.h>
+/**
+ * @file vector.h
+ *
+ * @brief Growable array of pointers
+ * Contiguous replacement for llist_t: amortised O(1) appends, O(1) access
+ *  by index and iteration over a single block of memory.
+ *
+ */
+
+/**
+ * Vector type
+ *
+ */
+typedef struct{
+    size_t size;
+    size_t capacity;
+    void **elements;
+}vector_t;
+
+
+/**
+ * @note Initial capacity of vectors created without one.
+ *
+ */
+#ifndef DEFAULT_VECTOR_CAPACITY
+    #define DEFAULT_VECTOR_CAPACITY 16
+#endif
+
+
+/**
+ * Description: Creates a new, empty vector.
+ *
+ * @return A vector.
+ */
+vector_t *create_vector();
+
+
+/**
+ * Description: Creates a new, empty vector with room for some elements.
+ *
+ * @param capacity The elements it can hold before growing.
+ *
+ * @return A vector.
+ */
+vector_t *create_vector_with_capacity(size_t capacity);
+
+
+/**
+ * Description: Makes room for some elements, so appending up to that many
+ * doesn't move the buffer.
+ *
+ * @param vector   Vector.
+ * @param capacity The number of elements it must hold.
+ *
+ */
+void reserve_vector(vector_t *vector, size_t capacity);
+
+
+/**
+ * Description: Add a pointer to the end of a vector.
+ *
+ * @param vector  Vector.
+ * @param element The element to be added to the vector.
+ *
+ * @return The index of the added element.
+ */
+size_t add_to_vector(vector_t *vector, void *element);
+
+
+/**
+ * Description: Retrieves an object from the vector.
+ *
+ * @param vector Vector.
+ * @param num    The index of the object to be retrieved, below its size.
+ *
+ * @return The pointer introduced in the 'num' position.
+ *
+ */
+static inline void *vector_element(const vector_t *vector, size_t num){
+    assert(num < vector->size);
+
+    return vector->elements[num];
+}
+
+
+/**
+ * Description: Frees the memory of a vector.
+ *
+ * @param vector The vector to be freed.
+ * @param free_content A pointer to the function to remove
+ *                     the contents (or NULL for none).
+ */
+void free_vector(vector_t *vector, void (*free_content) (void *));
+
+
+/**
+ * Description: merges two vectors. Appends `src` to `dst` and deletes
+ * `src` headers. The merged vector keeps whichever buffer already fits
+ * both, so merging into an empty or small vector takes over the buffer of
+ * `src` instead of copying it.
+ *
+ * @param dst Destination vector. Its elements will be first.
+ * @param src Source vector. Its elements will be last, and its headers
+ *              will be deleted.
+ *
+ * @return The merged vector.
+ *
+ */
+vector_t *merge_vectors(vector_t *dst, vector_t *src);
+
+#endif
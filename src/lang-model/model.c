@@ -3,10 +3,22 @@
 #include <assert.h>
 
 #include <ctype.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "model.h"
+#include "score_cache.h"
 #include "../ht/hash_table.h"
+#include "../ht/frozen_hash_table.h"
+#include "../ht/bloom_filter.h"
+#include "../ht/aho_corasick.h"
+
+#define ALLOC_MODULE ALLOC_LANGUAGE_MODEL
+#include "../ht/alloc_stats.h"
 
 #define TWO_GRAMS_DICTIONARY_SIZE 0x10000
 #define THREE_GRAMS_DICTIONARY_SIZE 0x1000000
@@ -15,16 +27,137 @@
 #define TWO_GRAM_SCORE_MODIFIER 1
 #define THREE_GRAM_SCORE_MODIFIER 90
 #define WORD_SCORE_MODIFIER 10000
+#define FOUR_GRAM_SCORE_MODIFIER 200
+#define FIVE_GRAM_SCORE_MODIFIER 400
+
+#define HIGH_ORDER_GRAM_HASHES 4
+
+/*
+ * Fixed point scoring: fractional values carry FIXED_POINT_SHIFT bits,
+ * n*log2(n) is tabulated for the symbol counts of short outputs and log2
+ * takes LOG2_MANTISSA_BITS of mantissa from a table.
+ */
+#define FIXED_POINT_SHIFT 16
+#define FIXED_POINT_ONE (1UL << FIXED_POINT_SHIFT)
+#define N_LOG2_N_TABLE_SIZE 1024
+#define LOG2_MANTISSA_BITS 10
+
+#define SCORE_BATCH_LANES 8
+#define SCORE_PREFETCH_DISTANCE 4
+#define SCORE_BATCH_MIN_PER_THREAD 32
+
+#define AUTOMATON_SCAN_CHUNK 256
+
+#define BUILD_MIN_PER_THREAD 0x10000
+#define BUILD_READ_BLOCK_SIZE 0x10000
+
+struct word_filter {
+    bloom_filter_t* filter;
+    double rate;
+
+    atomic_ulong candidates;
+    atomic_ulong rejects;
+    atomic_ulong hits;
+};
 
 struct language_model {
     unsigned short two_grams[TWO_GRAMS_DICTIONARY_SIZE];
     unsigned short three_grams[THREE_GRAMS_DICTIONARY_SIZE];
+    unsigned long char_counter[256];
     double expected_entropy;
+    unsigned long entropy_lower_bound;
+    unsigned long entropy_upper_bound;
+    int fixed_point;
+
+    // 4 and 5-grams, only their presence is recorded
+    bloom_filter_t* high_order_grams;
+
+    int score_threads;
+    score_cache* score_cache;
 
+    // Words are counted in `word_count` while building, then frozen
     struct hash_table* word_count;
+    frozen_hash_table_t words;
+
+    // Optional pre-check of the word lookups
+    struct word_filter* word_filter;
+
+    // Finds undelimited words when set, see language_model_set_word_engine()
+    aho_corasick_t* word_automaton;
+    size_t min_word_length;
 };
 
 
+static unsigned long n_log2_n_table[N_LOG2_N_TABLE_SIZE + 1];
+static unsigned long log2_mantissa_table[1 << LOG2_MANTISSA_BITS];
+static unsigned long word_length_bonus_table[MAX_WORD_SIZE];
+static pthread_once_t fixed_point_tables_once = PTHREAD_ONCE_INIT;
+
+
+static void build_fixed_point_tables(){
+    int i;
+
+    n_log2_n_table[0] = 0;
+    for (i = 1; i <= N_LOG2_N_TABLE_SIZE; i++){
+        n_log2_n_table[i] = i * log2(i) * FIXED_POINT_ONE + 0.5;
+    }
+
+    for (i = 0; i < (1 << LOG2_MANTISSA_BITS); i++){
+        log2_mantissa_table[i] = log2(1 + ((double) i) / (1 << LOG2_MANTISSA_BITS))
+            * FIXED_POINT_ONE + 0.5;
+    }
+
+    for (i = 0; i < MAX_WORD_SIZE; i++){
+        word_length_bonus_table[i] = pow(i, 1.5) * FIXED_POINT_ONE + 0.5;
+    }
+}
+
+
+static unsigned long fixed_log2(unsigned long n){
+    assert(n > 0);
+
+    int exponent = 63 - __builtin_clzl(n);
+    unsigned long mantissa = exponent >= LOG2_MANTISSA_BITS
+        ? n >> (exponent - LOG2_MANTISSA_BITS)
+        : n << (LOG2_MANTISSA_BITS - exponent);
+
+    return (((unsigned long) exponent) << FIXED_POINT_SHIFT)
+        + log2_mantissa_table[mantissa & ((1 << LOG2_MANTISSA_BITS) - 1)];
+}
+
+
+static unsigned long fixed_n_log2_n(unsigned long n){
+    if (n <= N_LOG2_N_TABLE_SIZE){
+        return n_log2_n_table[n];
+    }
+
+    return n * fixed_log2(n);
+}
+
+
+static unsigned long isqrt(unsigned long n){
+    unsigned long root = 0;
+    unsigned long bit = 1UL << 62;
+
+    while (bit > n){
+        bit >>= 2;
+    }
+
+    while (bit != 0){
+        if (n >= root + bit){
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+
 double shannon_entropy(long unsigned char_counter[]){
     unsigned long char_num = 0;
     int i;
@@ -46,66 +179,141 @@ double shannon_entropy(long unsigned char_counter[]){
     return -e_sum;
 }
 
-language_model* build_language_model(FILE *f){
-    language_model* model = malloc(sizeof(language_model));
+static void set_expected_entropy(language_model* model){
+    model->expected_entropy = shannon_entropy(model->char_counter);
+
+    model->entropy_lower_bound = (model->expected_entropy
+                                  - (model->expected_entropy * 0.20))
+        * FIXED_POINT_ONE;
+    model->entropy_upper_bound = (model->expected_entropy
+                                  + (model->expected_entropy * 0.20))
+        * FIXED_POINT_ONE;
+}
+
+
+static language_model* new_language_model(const language_model_options* options){
+    language_model* model = calloc(1, sizeof(language_model));
     if (model == NULL){
         return NULL;
     }
 
-    unsigned long char_counter[256];
-    memset(char_counter, 0, sizeof(long) * 256);
+    model->high_order_grams = NULL;
+    if (options->high_order_bytes > 0){
+        model->high_order_grams = create_bloom_filter(options->high_order_bytes,
+                                                      HIGH_ORDER_GRAM_HASHES);
+        if (model->high_order_grams == NULL){
+            free(model);
+            return NULL;
+        }
+    }
 
+    model->score_threads = 1;
+    model->score_cache = NULL;
     model->word_count = create_hash_table();
     if (model->word_count == NULL){
+        free_bloom_filter(model->high_order_grams);
         free(model);
         return NULL;
     }
 
-    // Set all two-grams counts to zero
+    return model;
+}
+
+
+static void free_word_filter(struct word_filter* word_filter){
+    if (word_filter != NULL){
+        free_bloom_filter(word_filter->filter);
+    }
+    free(word_filter);
+}
+
+
+// Hash of the `order` characters ending at `text`
+static uint64_t high_order_gram_hash(const unsigned char* text, int order){
+    uint64_t h = order;
+    int i;
+
+    for (i = 1 - order; i <= 0; i++){
+        h = (h << 8) | text[i];
+    }
+
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9UL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebUL;
+    h ^= h >> 31;
+
+    return h;
+}
+
+
+static void count_word(language_model* model, const char* word, size_t len,
+                       hash_t hash){
+
+    void *v = get_hash_table_prehashed(model->word_count, word, len, hash);
+    insert_hash_table_prehashed(model->word_count, word, len, hash,
+                                (void*) (((long)v) + 1));
+}
+
+
+/*
+ * Accounts the corpus characters in [start, end) as if the whole of
+ * `corpus` was read a character at a time. `start` must be 0 or follow a
+ * non alphanumeric character, so no word crosses into the range.
+ */
+static void scan_corpus(language_model* model,
+                        const unsigned char* corpus,
+                        size_t start, size_t end){
+
+    unsigned long* char_counter = model->char_counter;
     unsigned short* two_grams = model->two_grams;
     unsigned short* three_grams = model->three_grams;
 
-    memset(two_grams, 0, sizeof(short) * TWO_GRAMS_DICTIONARY_SIZE);
-    memset(three_grams, 0, sizeof(short) * THREE_GRAMS_DICTIONARY_SIZE);
+    // Words are read in place, hashed once they end
+    size_t word_start = 0;
+    int word_pos = 0;
 
-    unsigned char first = '\0';
-    unsigned char second = '\0';
-    int third = fgetc(f);
-    if (third == EOF){
-        free_language_model(model);
-        return NULL;
+    // Alphabetic characters up to the current one, capped at 5
+    int alpha_run = 0;
+    while ((alpha_run < 4) && ((size_t) alpha_run < start)
+           && isalpha(corpus[start - alpha_run - 1])){
+        alpha_run++;
     }
 
-    char_counter[third]++;
+    if ((start == 0) && (end > 0)){
+        unsigned char third = corpus[0];
+        char_counter[third]++;
 
-    char word[MAX_WORD_SIZE];
-    int word_pos = 0;
+        if ((third != ' ') && (third != '\n') && (third != '\r')){
+            word_pos++;
+        }
+        alpha_run = isalpha(third) ? 1 : 0;
 
-    if ((third != ' ') && (third != '\n') && (third != '\r')){
-        word[word_pos++] = third;
+        start = 1;
     }
 
-    while (!feof(f)){
+    size_t pos;
+    for (pos = start; pos < end; pos++){
 
-        first = second;
-        second = third;
-        third = fgetc(f);
+        unsigned char first = pos > 1 ? corpus[pos - 2] : '\0';
+        unsigned char second = corpus[pos - 1];
+        unsigned char third = corpus[pos];
 
-        if (third == EOF){
-            break;
-        }
         char_counter[third]++;
 
         // Build word list
         {
             if ((isalnum(third)) && (word_pos < (MAX_WORD_SIZE - 1))){
-                word[word_pos++] = third;
+                if (word_pos == 0){
+                    word_start = pos;
+                }
+                word_pos++;
             }
             else {
                 if (word_pos > 2){
-                    word[word_pos] = '\0';
-                    void *v = get_hash_table(model->word_count, word);
-                    insert_hash_table(model->word_count, word, (void*) (((long)v) + 1));
+                    const char* word = (const char*) &corpus[word_start];
+                    count_word(model, word, word_pos, get_hash_n(word, word_pos));
                 }
                 word_pos = 0;
             }
@@ -117,7 +325,7 @@ language_model* build_language_model(FILE *f){
 
                 assert((second != 0xFF));
                 assert((third != 0xFF));
-                unsigned int index = (second << 8) | ((unsigned char)third);
+                unsigned int index = (second << 8) | third;
                 assert((index >= 0) &&
                        (index < TWO_GRAMS_DICTIONARY_SIZE));
 
@@ -129,161 +337,1239 @@ language_model* build_language_model(FILE *f){
         {
             if (isalpha(first) && isalpha(second) && isalpha(third)){
 
-                unsigned int index = (first << 16) | (second << 8) | ((unsigned char)third);
+                unsigned int index = (first << 16) | (second << 8) | third;
                 assert((index >= 0) &&
                        (index < THREE_GRAMS_DICTIONARY_SIZE));
 
                 three_grams[index]++;
             }
         }
+
+        // Build four and five-grams
+        {
+            alpha_run = isalpha(third) ? alpha_run + (alpha_run < 5) : 0;
+
+            if ((model->high_order_grams != NULL) && (alpha_run >= 4)){
+                add_bloom_filter(model->high_order_grams,
+                                 high_order_gram_hash(&corpus[pos], 4));
+
+                if (alpha_run >= 5){
+                    add_bloom_filter(model->high_order_grams,
+                                     high_order_gram_hash(&corpus[pos], 5));
+                }
+            }
+        }
     }
 
-    model->expected_entropy = shannon_entropy(char_counter);
+    // A word still open at the end of the corpus is not counted
+}
+
 
-    return model;
+struct build_job {
+    language_model* shard;
+    const unsigned char* corpus;
+    size_t start;
+    size_t end;
+};
+
+
+static void *build_job(void *_job){
+    struct build_job *job = _job;
+
+    scan_corpus(job->shard, job->corpus, job->start, job->end);
+
+    return NULL;
 }
 
 
-void free_language_model(language_model* model){
-    if (model != NULL){
-        free_hash_table(model->word_count, NULL);
+static void add_word_count(language_model* model, const char* word,
+                           size_t len, void* count){
+
+    hash_t hash = get_hash_n(word, len);
+
+    void *v = get_hash_table_prehashed(model->word_count, word, len, hash);
+    insert_hash_table_prehashed(model->word_count, word, len, hash,
+                                (void*) (((long)v) + ((long) count)));
+}
+
+
+/*
+ * Replaces the counting table with a frozen one, for scoring. If freezing
+ * fails the counting table stays, it scores the same only slower.
+ */
+static void freeze_words(language_model* model){
+    if (model->word_count == NULL){
+        return;
     }
-    free(model);
+
+    frozen_hash_table_t words = freeze_hash_table(model->word_count);
+    if (words == NULL){
+        fprintf(stderr, "Freezing the dictionary failed, "
+                "scoring with the counting table\n");
+        return;
+    }
+
+    free_hash_table(model->word_count, NULL);
+    model->word_count = NULL;
+    model->words = words;
 }
 
 
-unsigned long language_model_score(const language_model* model,
-                                   const char *words){
+// Words of the model, frozen or not, with their counts
+struct word_iterator {
+    const language_model* model;
+    size_t index;
+    hash_table_iterator_t counting;
+};
+
+
+static struct word_iterator word_iterator(const language_model* model){
+    struct word_iterator it = { .model = model, .index = 0 };
+
+    if (model->words == NULL){
+        it.counting = hash_table_iterator(model->word_count);
+    }
+
+    return it;
+}
+
+
+static int next_word(struct word_iterator* it, const char** word,
+                     size_t* len, void** count){
+
+    if (it->model->words != NULL){
+        if (it->index >= frozen_hash_table_count(it->model->words)){
+            return 0;
+        }
+
+        *count = frozen_hash_table_entry(it->model->words, it->index++,
+                                         word, len);
+        return 1;
+    }
 
-    if ((words[0] == '\0') || (words[1] == '\0')){
+    if (!hash_table_next(&it->counting, word, count)){
         return 0;
     }
+    *len = strlen(*word);
 
-    double two_gram_score = 0;
-    double three_gram_score = 0;
-    int i;
+    return 1;
+}
 
-    const unsigned short* two_grams = model->two_grams;
-    for (i = 0; words[i + 1] != '\0'; i++){
 
-        unsigned char first = words[i];
-        unsigned char second = words[i + 1];
+static size_t word_total(const language_model* model){
+    return model->words != NULL
+        ? frozen_hash_table_count(model->words)
+        : hash_table_count(model->word_count);
+}
 
-        unsigned int index = (first << 8) | second;
 
-        assert((index >= 0) &&
-               (index < TWO_GRAMS_DICTIONARY_SIZE));
+static void* get_word(const language_model* model, const char* word,
+                      size_t len, frozen_hash_t hash){
 
-        two_gram_score += two_grams[index] != 0;
+    if (model->words != NULL){
+        return get_frozen_hash_table_prehashed(model->words, word, len, hash);
     }
 
-    const unsigned short* three_grams = model->three_grams;
-    for (i = 0; words[i + 2] != '\0'; i++){
+    return get_hash_table_prehashed(model->word_count, word, len,
+                                    get_hash_n(word, len));
+}
 
-        unsigned char first = words[i];
-        unsigned char second = words[i + 1];
-        unsigned char third = words[i + 2];
 
-        unsigned int index = (first << 16) | (second << 8) | third;
+static void thaw_words(language_model* model){
+    if (model->words != NULL){
+        model->word_count = thaw_hash_table(model->words);
+        free_frozen_hash_table(model->words);
+        model->words = NULL;
+    }
+}
 
-        assert((index >= 0) &&
-               (index < THREE_GRAMS_DICTIONARY_SIZE));
 
-        three_gram_score +=  three_grams[index] != 0;
+// Drops the cached scores, for changes to what a text scores
+static void forget_scores(language_model* model){
+    if (model->score_cache != NULL){
+        clear_score_cache(model->score_cache);
     }
+}
 
 
-    // Classify words and garbage
-    unsigned long word_score = 0;
+int merge_language_models(language_model* dst, const language_model* src){
+    size_t i;
 
-    char word[MAX_WORD_SIZE];
-    int word_pos = 0;
-    int garbage_size = 0;
+    forget_scores(dst);
 
-    for (i = 0; words[i] != '\0'; i++){
-        if (isalpha(words[i])){
-            if (word_pos < (MAX_WORD_SIZE - 1)){
-                word[word_pos++] = words[i];
-            }
-            else {
-                garbage_size += word_pos;
-                word_pos = 0;
+    for (i = 0; i < TWO_GRAMS_DICTIONARY_SIZE; i++){
+        dst->two_grams[i] += src->two_grams[i];
+    }
+
+    for (i = 0; i < THREE_GRAMS_DICTIONARY_SIZE; i++){
+        dst->three_grams[i] += src->three_grams[i];
+    }
+
+    for (i = 0; i < 256; i++){
+        dst->char_counter[i] += src->char_counter[i];
+    }
+
+    int frozen = dst->words != NULL;
+    thaw_words(dst);
+
+    struct word_iterator it = word_iterator(src);
+    const char* word;
+    size_t len;
+    void* count;
+
+    while (next_word(&it, &word, &len, &count)){
+        add_word_count(dst, word, len, count);
+    }
+
+    // A tier that can't hold the new grams would reject them
+    if ((dst->high_order_grams != NULL)
+        && ((src->high_order_grams == NULL)
+            || !merge_bloom_filters(dst->high_order_grams, src->high_order_grams))){
+
+        free_bloom_filter(dst->high_order_grams);
+        dst->high_order_grams = NULL;
+    }
+
+    set_expected_entropy(dst);
+
+    if (frozen){
+        freeze_words(dst);
+    }
+
+    if ((dst->word_filter != NULL)
+        && !language_model_enable_word_filter(dst, dst->word_filter->rate)){
+        return -1;
+    }
+
+    if ((dst->word_automaton != NULL)
+        && !language_model_set_word_engine(dst, LANGUAGE_MODEL_AUTOMATON_WORDS,
+                                           dst->min_word_length)){
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static language_model* build_from_corpus(const unsigned char* corpus, size_t size,
+                                         const language_model_options* options){
+
+    if (size == 0){
+        return NULL;
+    }
+
+    language_model* model = new_language_model(options);
+    if (model == NULL){
+        return NULL;
+    }
+
+    int threads = options->build_threads > 0 ? options->build_threads : 1;
+    if (size < ((size_t) threads * BUILD_MIN_PER_THREAD)){
+        threads = size / BUILD_MIN_PER_THREAD;
+    }
+
+    if (threads <= 1){
+        scan_corpus(model, corpus, 0, size);
+    }
+    else {
+        pthread_t workers[threads];
+        struct build_job jobs[threads];
+        int t, started, merged = 1;
+
+        // Split on non alphanumeric characters, so words stay in one shard
+        size_t start = 0;
+        for (t = 0; t < threads; t++){
+            size_t end = (size / threads) * (t + 1);
+
+            if (t == (threads - 1)){
+                end = size;
             }
-        }
-        else {
-            if (!isblank(words[i])){
-                garbage_size++;
+            while ((end < size) && ((end < 2) || isalnum(corpus[end - 1]))){
+                end++;
             }
-            if ((!isprint(words[i])) || (!isascii(words[i]))){
-                garbage_size++;
+            if (end < start){
+                end = start;
             }
 
-            if (word_pos > 1){
-                word[word_pos] = '\0';
-
-                void *v = get_hash_table(model->word_count, word);
+            jobs[t] = (struct build_job) {
+                t == 0 ? model : new_language_model(options), corpus, start, end
+            };
+            start = end;
 
-                if (v != NULL){
-                    word_score += pow(word_pos, 2);
-                }
-                else {
-                    garbage_size += word_pos;
-                }
+            if (jobs[t].shard == NULL){
+                break;
             }
-            else {
-                garbage_size += word_pos;
+        }
+        started = t;
+
+        for (t = 1; t < started; t++){
+            if (pthread_create(&workers[t], NULL, build_job, &jobs[t]) != 0){
+                workers[t] = pthread_self();
+                build_job(&jobs[t]);
             }
-            word_pos = 0;
         }
-    }
 
-    if (word_pos > 1){
-        word[word_pos] = '\0';
+        build_job(&jobs[0]);
 
-        void *v = get_hash_table(model->word_count, word);
+        for (t = 1; t < started; t++){
+            if (!pthread_equal(workers[t], pthread_self())){
+                pthread_join(workers[t], NULL);
+            }
 
-        if (v != NULL){
-            word_score += (pow(word_pos, 1.5) + (2 + log2((long) v)));
+            merged &= merge_language_models(model, jobs[t].shard) == 0;
+            free_language_model(jobs[t].shard);
         }
-        else {
-            garbage_size += word_pos;
+
+        if ((started < threads) || !merged){
+            free_language_model(model);
+            return NULL;
         }
     }
-    else {
-        garbage_size += word_pos;
-    }
 
+    set_expected_entropy(model);
+    freeze_words(model);
 
-    unsigned long char_count[256];
-    memset(char_count, 0, sizeof(long) * 256);
-    for (i = 0; words[i] != '\0'; i++){
-        char_count[(unsigned char) words[i]]++;
-    }
+    return model;
+}
 
 
-    double entropy = shannon_entropy(char_count);
-    double entropy_diff = 0;
+/*
+ * Maps the rest of the file, or reads it in blocks when it can't be mapped
+ * (pipes, special files...).
+ */
+static language_model* build_from_stream(FILE *f,
+                                         const language_model_options* options){
+    struct stat st;
+    long offset = ftell(f);
 
-    double lower_bound = model->expected_entropy - (model->expected_entropy * 0.20);
-    double upper_bound = model->expected_entropy + (model->expected_entropy * 0.20);
+    if ((offset >= 0) && (fstat(fileno(f), &st) == 0)
+        && S_ISREG(st.st_mode) && (st.st_size > offset)){
 
-    if (entropy < lower_bound){
-        entropy_diff = lower_bound - entropy;
-    }
-    else if (entropy > upper_bound){
-        entropy_diff = entropy - upper_bound;
+        unsigned char* corpus = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                                     fileno(f), 0);
+
+        if (corpus != MAP_FAILED){
+            madvise(corpus, st.st_size, MADV_SEQUENTIAL);
+
+            language_model* model = build_from_corpus(&corpus[offset],
+                                                      st.st_size - offset,
+                                                      options);
+            munmap(corpus, st.st_size);
+            fseek(f, 0, SEEK_END);
+
+            return model;
+        }
     }
 
-    unsigned long penalization_divider = (pow(garbage_size + 2, 2)
-                                          + pow(entropy_diff * 10, 2));
+    size_t size = 0;
+    size_t capacity = BUILD_READ_BLOCK_SIZE;
+    unsigned char* corpus = malloc(capacity);
 
-    double general_score = ((two_gram_score * TWO_GRAM_SCORE_MODIFIER)
-                         + (three_gram_score * THREE_GRAM_SCORE_MODIFIER)
-                         + (word_score * WORD_SCORE_MODIFIER));
+    while (corpus != NULL){
+        size_t read = fread(&corpus[size], 1, capacity - size, f);
+        size += read;
 
-    unsigned long final_score = ((double) (10 * general_score)) / (pow(penalization_divider, 0.5));
+        if (read == 0){
+            break;
+        }
 
-    assert((general_score == 0) || ((general_score * 10) > final_score));
+        if (size == capacity){
+            unsigned char* grown = realloc(corpus, capacity * 2);
+            if (grown == NULL){
+                free(corpus);
+                return NULL;
+            }
+            corpus = grown;
+            capacity *= 2;
+        }
+    }
 
-    return final_score;
+    if (corpus == NULL){
+        return NULL;
+    }
+
+    language_model* model = build_from_corpus(corpus, size, options);
+    free(corpus);
+
+    return model;
+}
+
+
+void language_model_default_options(language_model_options* options){
+    options->build_threads = 1;
+    options->high_order_bytes = 0;
+}
+
+
+language_model* build_language_model_with_options(
+    FILE *f, const language_model_options* options){
+
+    return build_from_stream(f, options);
+}
+
+
+language_model* build_language_model(FILE *f){
+    language_model_options options;
+    language_model_default_options(&options);
+
+    return build_language_model_with_options(f, &options);
+}
+
+
+int compare_language_models(const language_model* model1,
+                            const language_model* model2){
+
+    if ((memcmp(model1->two_grams, model2->two_grams,
+                sizeof(model1->two_grams)) != 0)
+        || (memcmp(model1->three_grams, model2->three_grams,
+                   sizeof(model1->three_grams)) != 0)
+        || (memcmp(model1->char_counter, model2->char_counter,
+                   sizeof(model1->char_counter)) != 0)){
+        return 1;
+    }
+
+    if ((model1->high_order_grams == NULL) != (model2->high_order_grams == NULL)){
+        return 1;
+    }
+    if ((model1->high_order_grams != NULL)
+        && !equal_bloom_filters(model1->high_order_grams,
+                                model2->high_order_grams)){
+        return 1;
+    }
+
+    if (word_total(model1) != word_total(model2)){
+        return 1;
+    }
+
+    struct word_iterator it = word_iterator(model1);
+    const char* word;
+    size_t len;
+    void* word_count;
+
+    while (next_word(&it, &word, &len, &word_count)){
+        if (get_word(model2, word, len, get_frozen_hash_n(word, len))
+            != word_count){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void free_language_model(language_model* model){
+    if (model != NULL){
+        free_hash_table(model->word_count, NULL);
+        free_frozen_hash_table(model->words);
+        free_word_filter(model->word_filter);
+        free_aho_corasick(model->word_automaton);
+        free_bloom_filter(model->high_order_grams);
+        free_score_cache(model->score_cache);
+    }
+    free(model);
+}
+
+
+static void gram_scores(const language_model* model,
+                        const char *words, size_t len,
+                        unsigned long *two_gram_score,
+                        unsigned long *three_gram_score){
+
+    size_t i;
+
+    const unsigned short* two_grams = model->two_grams;
+    for (i = 0; (i + 1) < len; i++){
+
+        unsigned char first = words[i];
+        unsigned char second = words[i + 1];
+
+        unsigned int index = (first << 8) | second;
+
+        assert((index >= 0) &&
+               (index < TWO_GRAMS_DICTIONARY_SIZE));
+
+        *two_gram_score += two_grams[index] != 0;
+    }
+
+    const unsigned short* three_grams = model->three_grams;
+    for (i = 0; (i + 2) < len; i++){
+
+        unsigned char first = words[i];
+        unsigned char second = words[i + 1];
+        unsigned char third = words[i + 2];
+
+        unsigned int index = (first << 16) | (second << 8) | third;
+
+        assert((index >= 0) &&
+               (index < THREE_GRAMS_DICTIONARY_SIZE));
+
+        *three_gram_score +=  three_grams[index] != 0;
+    }
+}
+
+
+static unsigned long high_order_gram_score(const language_model* model,
+                                    const char *words, size_t len){
+
+    const unsigned char* text = (const unsigned char*) words;
+    unsigned long score = 0;
+    int alpha_run = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++){
+        alpha_run = isalpha(text[i]) ? alpha_run + (alpha_run < 5) : 0;
+
+        if (alpha_run >= 4){
+            if (check_bloom_filter(model->high_order_grams,
+                                   high_order_gram_hash(&text[i], 4))){
+
+                score += FOUR_GRAM_SCORE_MODIFIER;
+
+                if ((alpha_run >= 5)
+                    && check_bloom_filter(model->high_order_grams,
+                                          high_order_gram_hash(&text[i], 5))){
+
+                    score += FIVE_GRAM_SCORE_MODIFIER;
+                }
+            }
+        }
+    }
+
+    return score;
+}
+
+
+/*
+ * Integer version of the entropy and garbage penalization, see
+ * language_model_set_fixed_point() for its tolerance.
+ */
+static unsigned long fixed_point_score(const language_model* model,
+                                       const unsigned long char_count[],
+                                       size_t len, unsigned long garbage_size,
+                                       unsigned long general_score){
+
+    // H = log2(N) - sum(c * log2(c)) / N
+    unsigned long counts_entropy = 0;
+    int i;
+
+    for (i = 0; i < 256; i++){
+        counts_entropy += fixed_n_log2_n(char_count[i]);
+    }
+
+    unsigned long entropy = (fixed_n_log2_n(len) - counts_entropy) / len;
+    unsigned long entropy_diff = 0;
+
+    if (entropy < model->entropy_lower_bound){
+        entropy_diff = model->entropy_lower_bound - entropy;
+    }
+    else if (entropy > model->entropy_upper_bound){
+        entropy_diff = entropy - model->entropy_upper_bound;
+    }
+
+    unsigned long penalization_divider = ((garbage_size + 2) * (garbage_size + 2))
+        + ((100 * entropy_diff * entropy_diff) >> (2 * FIXED_POINT_SHIFT));
+
+    unsigned __int128 scaled_score = ((unsigned __int128) (10 * general_score))
+        << FIXED_POINT_SHIFT;
+
+    // The root takes as many fractional bits as the divider leaves room
+    // for, fewer for long garbage
+    int root_shift = FIXED_POINT_SHIFT;
+    while ((root_shift > 0)
+           && (penalization_divider > (ULONG_MAX >> (2 * root_shift)))){
+        root_shift--;
+    }
+
+    unsigned long root = isqrt(penalization_divider << (2 * root_shift))
+        << (FIXED_POINT_SHIFT - root_shift);
+
+    return scaled_score / root;
+}
+
+
+struct word_lookup_counts {
+    unsigned long candidates;
+    unsigned long rejects;
+    unsigned long hits;
+};
+
+
+static void* lookup_word(const language_model* model, const char* word,
+                         size_t len, struct word_lookup_counts* counts){
+
+    frozen_hash_t hash = get_frozen_hash_n(word, len);
+
+    if (model->word_filter != NULL){
+        counts->candidates++;
+
+        if (!check_bloom_filter(model->word_filter->filter, hash)){
+            counts->rejects++;
+            return NULL;
+        }
+    }
+
+    void* v = get_word(model, word, len, hash);
+    counts->hits += v != NULL;
+
+    return v;
+}
+
+
+// Alphabetic runs are words when they are in the dictionary, garbage if not
+static void delimited_words(const language_model* model,
+                            const char *words, size_t len,
+                            unsigned long *word_score_out,
+                            int *garbage_size_out){
+    size_t i;
+    unsigned long word_score = 0;
+
+    // Words are looked up in place
+    size_t word_start = 0;
+    int word_pos = 0;
+    struct word_lookup_counts counts = {0, 0, 0};
+    int garbage_size = 0;
+
+    for (i = 0; i < len; i++){
+        if (isalpha(words[i])){
+            if (word_pos < (MAX_WORD_SIZE - 1)){
+                if (word_pos == 0){
+                    word_start = i;
+                }
+                word_pos++;
+            }
+            else {
+                garbage_size += word_pos;
+                word_pos = 0;
+            }
+        }
+        else {
+            if (!isblank(words[i])){
+                garbage_size++;
+            }
+            if ((!isprint(words[i])) || (!isascii(words[i]))){
+                garbage_size++;
+            }
+
+            if (word_pos > 1){
+                void *v = lookup_word(model, &words[word_start], word_pos,
+                                      &counts);
+
+                if (v != NULL){
+                    word_score += word_pos * word_pos;
+                }
+                else {
+                    garbage_size += word_pos;
+                }
+            }
+            else {
+                garbage_size += word_pos;
+            }
+            word_pos = 0;
+        }
+    }
+
+    if (word_pos > 1){
+        void *v = lookup_word(model, &words[word_start], word_pos,
+                              &counts);
+
+        if (v != NULL){
+            if (model->fixed_point){
+                word_score += (word_length_bonus_table[word_pos]
+                               + (2 << FIXED_POINT_SHIFT)
+                               + fixed_log2((long) v)) >> FIXED_POINT_SHIFT;
+            }
+            else {
+                word_score += (pow(word_pos, 1.5) + (2 + log2((long) v)));
+            }
+        }
+        else {
+            garbage_size += word_pos;
+        }
+    }
+    else {
+        garbage_size += word_pos;
+    }
+
+    if (counts.candidates > 0){
+        struct word_filter* word_filter = model->word_filter;
+
+        atomic_fetch_add_explicit(&word_filter->candidates, counts.candidates,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&word_filter->rejects, counts.rejects,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&word_filter->hits, counts.hits,
+                                  memory_order_relaxed);
+    }
+
+    *word_score_out = word_score;
+    *garbage_size_out = garbage_size;
+}
+
+
+/*
+ * Every dictionary word in the text counts, delimited or not. Matches are
+ * taken greedily from the left, a longer match replaces all the ones it
+ * covers (unless it would cut one in two), and the letters no match
+ * covers are garbage. Digits count as letters, as dictionary words are
+ * alphanumeric.
+ */
+static void automaton_words(const language_model* model,
+                            const char *words, size_t len,
+                            unsigned long *word_score_out,
+                            int *garbage_size_out){
+    uint16_t matches[AUTOMATON_SCAN_CHUNK];
+    aho_corasick_state_t state = AHO_CORASICK_START;
+    unsigned long word_score = 0;
+    size_t letters = 0, covered = 0;
+
+    // Accepted matches, the last MAX_WORD_SIZE of them: dictionary words
+    // are shorter, so a match never covers older ones
+    size_t starts[MAX_WORD_SIZE], ends[MAX_WORD_SIZE];
+    size_t top = 0, depth = 0;
+    int garbage_size = 0;
+    size_t chunk, i;
+
+    for (chunk = 0; chunk < len; chunk += AUTOMATON_SCAN_CHUNK){
+        size_t chunk_len = len - chunk;
+        if (chunk_len > AUTOMATON_SCAN_CHUNK){
+            chunk_len = AUTOMATON_SCAN_CHUNK;
+        }
+
+        scan_aho_corasick(model->word_automaton, &state, &words[chunk],
+                          chunk_len, matches);
+
+        for (i = 0; i < chunk_len; i++){
+            size_t match = matches[i];
+            size_t end = chunk + i + 1;
+
+            if (isalnum(words[chunk + i])){
+                letters++;
+            }
+            else {
+                if (!isblank(words[chunk + i])){
+                    garbage_size++;
+                }
+                if ((!isprint(words[chunk + i])) || (!isascii(words[chunk + i]))){
+                    garbage_size++;
+                }
+            }
+
+            if (match < model->min_word_length){
+                continue;
+            }
+
+            size_t start = end - match;
+            size_t below = top, left = depth;
+            while ((left > 0) && (starts[(below - 1) % MAX_WORD_SIZE] >= start)){
+                below--;
+                left--;
+            }
+            if ((left > 0) && (ends[(below - 1) % MAX_WORD_SIZE] > start)){
+                continue;
+            }
+
+            for (; top > below; top--, depth--){
+                size_t last = ends[(top - 1) % MAX_WORD_SIZE]
+                    - starts[(top - 1) % MAX_WORD_SIZE];
+
+                word_score -= last * last;
+                covered -= last;
+            }
+
+            starts[top % MAX_WORD_SIZE] = start;
+            ends[top % MAX_WORD_SIZE] = end;
+            top++;
+            if (depth < MAX_WORD_SIZE){
+                depth++;
+            }
+
+            word_score += match * match;
+            covered += match;
+        }
+    }
+
+    assert(covered <= letters);
+
+    *word_score_out = word_score;
+    *garbage_size_out = garbage_size + (letters - covered);
+}
+
+
+static unsigned long finish_score(const language_model* model,
+                                  const char *words, size_t len,
+                                  unsigned long two_gram_score,
+                                  unsigned long three_gram_score){
+    // Classify words and garbage
+    unsigned long word_score = 0;
+    int garbage_size = 0;
+
+    if (model->word_automaton != NULL){
+        automaton_words(model, words, len, &word_score, &garbage_size);
+    }
+    else {
+        delimited_words(model, words, len, &word_score, &garbage_size);
+    }
+
+    size_t i;
+    unsigned long char_count[256];
+    memset(char_count, 0, sizeof(long) * 256);
+    for (i = 0; i < len; i++){
+        char_count[(unsigned char) words[i]]++;
+    }
+
+    if (model->fixed_point){
+        unsigned long general_score = (two_gram_score * TWO_GRAM_SCORE_MODIFIER)
+            + (three_gram_score * THREE_GRAM_SCORE_MODIFIER)
+            + (word_score * WORD_SCORE_MODIFIER);
+
+        if (model->high_order_grams != NULL){
+            general_score += high_order_gram_score(model, words, len);
+        }
+
+        return fixed_point_score(model, char_count, len,
+                                 garbage_size, general_score);
+    }
+
+
+    double entropy = shannon_entropy(char_count);
+    double entropy_diff = 0;
+
+    double lower_bound = model->expected_entropy - (model->expected_entropy * 0.20);
+    double upper_bound = model->expected_entropy + (model->expected_entropy * 0.20);
+
+    if (entropy < lower_bound){
+        entropy_diff = lower_bound - entropy;
+    }
+    else if (entropy > upper_bound){
+        entropy_diff = entropy - upper_bound;
+    }
+
+    unsigned long penalization_divider = (pow(garbage_size + 2, 2)
+                                          + pow(entropy_diff * 10, 2));
+
+    double general_score = ((two_gram_score * TWO_GRAM_SCORE_MODIFIER)
+                         + (three_gram_score * THREE_GRAM_SCORE_MODIFIER)
+                         + (word_score * WORD_SCORE_MODIFIER));
+
+    if (model->high_order_grams != NULL){
+        general_score += high_order_gram_score(model, words, len);
+    }
+
+    unsigned long final_score = ((double) (10 * general_score)) / (pow(penalization_divider, 0.5));
+
+    assert((general_score == 0) || ((general_score * 10) > final_score));
+
+    return final_score;
+}
+
+
+static unsigned long text_hash(const char *text, size_t len){
+    // FNV-1a
+    unsigned long h = 0xcbf29ce484222325UL;
+    size_t i;
+
+    for (i = 0; i < len; i++){
+        h ^= (unsigned char) text[i];
+        h *= 0x100000001b3UL;
+    }
+
+    return h;
+}
+
+
+unsigned long language_model_score(const language_model* model,
+                                   const char *words){
+
+    return language_model_score_n(model, words, strlen(words));
+}
+
+
+unsigned long language_model_score_n(const language_model* model,
+                                     const char *words, size_t len){
+
+    if (len < 2){
+        return 0;
+    }
+
+    unsigned long hash = 0;
+    unsigned long score;
+
+    if (model->score_cache != NULL){
+        hash = text_hash(words, len);
+        if (score_cache_get(model->score_cache, hash, len, &score)){
+            return score;
+        }
+    }
+
+    unsigned long two_gram_score = 0;
+    unsigned long three_gram_score = 0;
+
+    gram_scores(model, words, len, &two_gram_score, &three_gram_score);
+
+    score = finish_score(model, words, len, two_gram_score, three_gram_score);
+
+    if (model->score_cache != NULL){
+        score_cache_put(model->score_cache, hash, len, score);
+    }
+
+    return score;
+}
+
+
+/*
+ * Batch scoring.
+ *
+ * Texts are first deduplicated, then the n-gram probes of up to
+ * SCORE_BATCH_LANES texts are interleaved so the (mostly cache-missing)
+ * three-gram lookups of one text overlap with those of the others.
+ */
+struct batch_entry {
+    unsigned long hash;
+    size_t len;
+    size_t index;
+};
+
+
+static int batch_entry_cmp(const void *_e1, const void *_e2){
+    const struct batch_entry *e1 = _e1;
+    const struct batch_entry *e2 = _e2;
+
+    if (e1->hash != e2->hash){
+        return e1->hash < e2->hash ? -1 : 1;
+    }
+    if (e1->len != e2->len){
+        return e1->len < e2->len ? -1 : 1;
+    }
+    return (e1->index > e2->index) - (e1->index < e2->index);
+}
+
+
+static void score_lanes(const language_model* model,
+                        const char **texts, const size_t *lens,
+                        const size_t *indexes, size_t lanes,
+                        unsigned long *out){
+
+    const unsigned short* two_grams = model->two_grams;
+    const unsigned short* three_grams = model->three_grams;
+
+    unsigned long two_gram_score[SCORE_BATCH_LANES];
+    unsigned long three_gram_score[SCORE_BATCH_LANES];
+    size_t max_len = 0;
+    size_t lane, pos;
+
+    for (lane = 0; lane < lanes; lane++){
+        size_t len = lens[indexes[lane]];
+        const unsigned char *text = (const unsigned char*) texts[indexes[lane]];
+
+        two_gram_score[lane] = three_gram_score[lane] = 0;
+        if (len > max_len){
+            max_len = len;
+        }
+
+        for (pos = 0; ((pos + 2) < len) && (pos < SCORE_PREFETCH_DISTANCE); pos++){
+            __builtin_prefetch(&three_grams[(text[pos] << 16)
+                                            | (text[pos + 1] << 8)
+                                            | text[pos + 2]]);
+        }
+    }
+
+    for (pos = 0; (pos + 1) < max_len; pos++){
+        for (lane = 0; lane < lanes; lane++){
+            size_t len = lens[indexes[lane]];
+            const unsigned char *text = (const unsigned char*) texts[indexes[lane]];
+
+            if ((pos + 1) >= len){
+                continue;
+            }
+
+            size_t ahead = pos + SCORE_PREFETCH_DISTANCE;
+            if ((ahead + 2) < len){
+                __builtin_prefetch(&three_grams[(text[ahead] << 16)
+                                                | (text[ahead + 1] << 8)
+                                                | text[ahead + 2]]);
+            }
+
+            two_gram_score[lane] += two_grams[(text[pos] << 8) | text[pos + 1]] != 0;
+
+            if ((pos + 2) < len){
+                three_gram_score[lane] += three_grams[(text[pos] << 16)
+                                                      | (text[pos + 1] << 8)
+                                                      | text[pos + 2]] != 0;
+            }
+        }
+    }
+
+    for (lane = 0; lane < lanes; lane++){
+        size_t index = indexes[lane];
+
+        if (lens[index] < 2){
+            out[index] = 0;
+        }
+        else {
+            out[index] = finish_score(model, texts[index], lens[index],
+                                      two_gram_score[lane],
+                                      three_gram_score[lane]);
+        }
+    }
+}
+
+
+struct batch_job {
+    const language_model* model;
+    const char **texts;
+    const size_t *lens;
+    const size_t *indexes;
+    size_t count;
+    unsigned long *out;
+};
+
+
+static void *score_batch_job(void *_job){
+    const struct batch_job *job = _job;
+    size_t i;
+
+    for (i = 0; i < job->count; i += SCORE_BATCH_LANES){
+        size_t lanes = job->count - i;
+        if (lanes > SCORE_BATCH_LANES){
+            lanes = SCORE_BATCH_LANES;
+        }
+
+        score_lanes(job->model, job->texts, job->lens,
+                    &job->indexes[i], lanes, job->out);
+    }
+
+    return NULL;
+}
+
+
+void language_model_score_batch(const language_model* model,
+                                const char **texts, const size_t *lens,
+                                size_t n, unsigned long *out){
+    if (n == 0){
+        return;
+    }
+
+    struct batch_entry *entries = malloc(sizeof(struct batch_entry) * n);
+    size_t *unique = malloc(sizeof(size_t) * n);
+    unsigned long *hashes = malloc(sizeof(unsigned long) * n);
+    assert((entries != NULL) && (unique != NULL) && (hashes != NULL));
+
+    size_t i, unique_count = 0;
+    for (i = 0; i < n; i++){
+        entries[i].hash = hashes[i] = text_hash(texts[i], lens[i]);
+        entries[i].len = lens[i];
+        entries[i].index = i;
+    }
+
+    qsort(entries, n, sizeof(struct batch_entry), batch_entry_cmp);
+
+    // The first of every run of equal texts gets scored, unless cached
+    for (i = 0; i < n; i++){
+        if ((i == 0)
+            || (entries[i].hash != entries[i - 1].hash)
+            || (entries[i].len != entries[i - 1].len)
+            || (memcmp(texts[entries[i].index],
+                       texts[entries[i - 1].index], entries[i].len) != 0)){
+
+            size_t index = entries[i].index;
+
+            if ((model->score_cache == NULL) || (lens[index] < 2)
+                || !score_cache_get(model->score_cache, entries[i].hash,
+                                    lens[index], &out[index])){
+
+                unique[unique_count++] = index;
+            }
+        }
+    }
+
+    int threads = model->score_threads;
+    if (unique_count < (size_t) threads * SCORE_BATCH_MIN_PER_THREAD){
+        threads = unique_count / SCORE_BATCH_MIN_PER_THREAD;
+    }
+
+    if (threads <= 1){
+        struct batch_job job = { model, texts, lens, unique, unique_count, out };
+        score_batch_job(&job);
+    }
+    else {
+        pthread_t workers[threads];
+        struct batch_job jobs[threads];
+        size_t from = 0;
+        int t;
+
+        for (t = 0; t < threads; t++){
+            size_t count = (unique_count - from) / (threads - t);
+
+            jobs[t] = (struct batch_job) { model, texts, lens,
+                                           &unique[from], count, out };
+            from += count;
+
+            if ((t > 0) && (pthread_create(&workers[t], NULL,
+                                           score_batch_job, &jobs[t]) != 0)){
+                // Run it here if no thread is available
+                workers[t] = pthread_self();
+                score_batch_job(&jobs[t]);
+            }
+        }
+
+        score_batch_job(&jobs[0]);
+
+        for (t = 1; t < threads; t++){
+            if (!pthread_equal(workers[t], pthread_self())){
+                pthread_join(workers[t], NULL);
+            }
+        }
+    }
+
+    if (model->score_cache != NULL){
+        for (i = 0; i < unique_count; i++){
+            size_t index = unique[i];
+            if (lens[index] >= 2){
+                score_cache_put(model->score_cache, hashes[index],
+                                lens[index], out[index]);
+            }
+        }
+    }
+
+    // Copy the scores to the duplicates
+    for (i = 1; i < n; i++){
+        if ((entries[i].hash == entries[i - 1].hash)
+            && (entries[i].len == entries[i - 1].len)
+            && (memcmp(texts[entries[i].index],
+                       texts[entries[i - 1].index], entries[i].len) == 0)){
+
+            out[entries[i].index] = out[entries[i - 1].index];
+        }
+    }
+
+    free(hashes);
+    free(unique);
+    free(entries);
+}
+
+
+void language_model_set_score_threads(language_model* model, int threads){
+    model->score_threads = threads > 0 ? threads : 1;
+}
+
+
+int language_model_enable_score_cache(language_model* model, size_t bytes){
+    free_score_cache(model->score_cache);
+
+    model->score_cache = create_score_cache(bytes);
+
+    return model->score_cache != NULL;
+}
+
+
+int language_model_score_cache_stats(const language_model* model,
+                                     score_cache_stats* stats){
+    if (model->score_cache == NULL){
+        return 0;
+    }
+
+    get_score_cache_stats(model->score_cache, stats);
+    return 1;
+}
+
+
+int language_model_enable_word_filter(language_model* model, double rate){
+    bloom_filter_t* filter = create_bloom_filter_for_rate(word_total(model),
+                                                          rate);
+    if (filter == NULL){
+        return 0;
+    }
+
+    struct word_iterator it = word_iterator(model);
+    const char* word;
+    size_t len;
+    void* count;
+
+    while (next_word(&it, &word, &len, &count)){
+        add_bloom_filter(filter, get_frozen_hash_n(word, len));
+    }
+
+    struct word_filter* word_filter = malloc(sizeof(struct word_filter));
+    if (word_filter == NULL){
+        free_bloom_filter(filter);
+        return 0;
+    }
+
+    word_filter->filter = filter;
+    word_filter->rate = rate;
+    atomic_init(&word_filter->candidates, 0);
+    atomic_init(&word_filter->rejects, 0);
+    atomic_init(&word_filter->hits, 0);
+
+    free_word_filter(model->word_filter);
+    model->word_filter = word_filter;
+
+    return 1;
+}
+
+
+int language_model_word_filter_stats(const language_model* model,
+                                     word_filter_stats* stats){
+    if (model->word_filter == NULL){
+        return 0;
+    }
+
+    stats->candidates = atomic_load(&model->word_filter->candidates);
+    stats->rejects = atomic_load(&model->word_filter->rejects);
+    stats->hits = atomic_load(&model->word_filter->hits);
+    stats->bytes = bloom_filter_size(model->word_filter->filter);
+
+    return 1;
+}
+
+
+int language_model_set_word_engine(language_model* model,
+                                   language_model_word_engine engine,
+                                   size_t min_length){
+    aho_corasick_t* automaton = NULL;
+
+    if (engine == LANGUAGE_MODEL_AUTOMATON_WORDS){
+        size_t count = word_total(model);
+        const char** words = malloc(sizeof(char*) * (count + 1));
+        size_t* lengths = malloc(sizeof(size_t) * (count + 1));
+        size_t i = 0;
+
+        if ((words != NULL) && (lengths != NULL)){
+            struct word_iterator it = word_iterator(model);
+            void* word_count;
+
+            while (next_word(&it, &words[i], &lengths[i], &word_count)){
+                i++;
+            }
+
+            automaton = create_aho_corasick(words, lengths, count);
+        }
+
+        free(words);
+        free(lengths);
+
+        if (automaton == NULL){
+            return 0;
+        }
+    }
+
+    free_aho_corasick(model->word_automaton);
+    model->word_automaton = automaton;
+    model->min_word_length = min_length > 0 ? min_length : 1;
+    forget_scores(model);
+
+    return 1;
+}
+
+
+/*
+ * Switches the scoring arithmetic to integers and tables. Fixed point
+ * scores stay within 0.5% (or 1 unit) of the floating point ones, see
+ * 'happy-bench fixed' for the measured error and ranking agreement.
+ */
+void language_model_set_fixed_point(language_model* model, int fixed_point){
+    pthread_once(&fixed_point_tables_once, build_fixed_point_tables);
+
+    model->fixed_point = fixed_point;
+    forget_scores(model);
 }
@@ -2,11 +2,82 @@
 #define LANG_MODEL_MODEL_H
 
 #include <stdio.h>
+#include "score_cache.h"
 
 typedef struct language_model language_model;
 
+typedef struct {
+    // Threads reading the corpus, each one builds a shard of the model
+    int build_threads;
+
+    /*
+     * Memory for the 4 and 5-gram tier (a bloom filter over the corpus
+     * grams), 0 to disable it.
+     */
+    size_t high_order_bytes;
+} language_model_options;
+
+void language_model_default_options(language_model_options* options);
+
 language_model* build_language_model(FILE *f);
+language_model* build_language_model_with_options(
+    FILE *f, const language_model_options* options);
 void free_language_model(language_model* model);
+
+/*
+ * Adds the counts of `src` to `dst`. Note that the n-grams crossing from
+ * one corpus to the next are not accounted. Returns 0, or -1 if the word
+ * filter or automaton of `dst` couldn't be rebuilt, which leaves it
+ * unusable.
+ */
+int merge_language_models(language_model* dst, const language_model* src);
+
+/* Returns 0 if both models hold the same counts. */
+int compare_language_models(const language_model* model1,
+                            const language_model* model2);
 unsigned long language_model_score(const language_model* model, const char* text);
+unsigned long language_model_score_n(const language_model* model, const char* text, size_t len);
+
+/* Scores `n` texts at once, `out[i]` receives the score of `texts[i]`. */
+void language_model_score_batch(const language_model* model,
+                                const char **texts, const size_t *lens,
+                                size_t n, unsigned long *out);
+
+void language_model_set_score_threads(language_model* model, int threads);
+void language_model_set_fixed_point(language_model* model, int fixed_point);
+
+/* Memoises scores by output in a cache of (at most) `bytes` bytes. */
+int language_model_enable_score_cache(language_model* model, size_t bytes);
+int language_model_score_cache_stats(const language_model* model,
+                                     score_cache_stats* stats);
+
+/*
+ * Rejects most dictionary misses with a bloom filter over the words, sized
+ * for the given false positive rate.
+ */
+typedef struct {
+    unsigned long candidates;   // Words checked against the filter
+    unsigned long rejects;      // Discarded by the filter
+    unsigned long hits;         // Passed the filter and found in the table
+    size_t bytes;               // Filter size
+} word_filter_stats;
+
+int language_model_enable_word_filter(language_model* model, double rate);
+int language_model_word_filter_stats(const language_model* model,
+                                     word_filter_stats* stats);
+
+/*
+ * How the scorer finds words. Delimited words are the alphabetic runs of
+ * the text, the automaton finds every dictionary word of at least
+ * `min_length` characters even when spaces are missing or corrupted.
+ */
+typedef enum {
+    LANGUAGE_MODEL_DELIMITED_WORDS,
+    LANGUAGE_MODEL_AUTOMATON_WORDS,
+} language_model_word_engine;
+
+int language_model_set_word_engine(language_model* model,
+                                   language_model_word_engine engine,
+                                   size_t min_length);
 
 #endif
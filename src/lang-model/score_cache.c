@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <assert.h>
+
+#include "score_cache.h"
+
+#define ALLOC_MODULE ALLOC_SCORE_CACHE
+#include "../ht/alloc_stats.h"
+
+struct score_cache_entry {
+    // Odd while the entry is being written
+    atomic_ulong sequence;
+    atomic_ulong hash;
+    // Length + 1, so 0 marks an empty entry
+    atomic_ulong key_len;
+    atomic_ulong score;
+};
+
+struct score_cache {
+    size_t mask;
+    struct score_cache_entry* entries;
+
+    atomic_ulong hits;
+    atomic_ulong misses;
+    atomic_ulong evictions;
+};
+
+
+score_cache* create_score_cache(size_t bytes){
+    size_t count = 1;
+    while ((count * 2 * sizeof(struct score_cache_entry)) <= bytes){
+        count *= 2;
+    }
+
+    score_cache* cache = malloc(sizeof(score_cache));
+    if (cache == NULL){
+        return NULL;
+    }
+
+    cache->entries = calloc(count, sizeof(struct score_cache_entry));
+    if (cache->entries == NULL){
+        free(cache);
+        return NULL;
+    }
+
+    cache->mask = count - 1;
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->evictions, 0);
+
+    return cache;
+}
+
+
+void free_score_cache(score_cache* cache){
+    if (cache != NULL){
+        free(cache->entries);
+    }
+    free(cache);
+}
+
+
+int score_cache_get(score_cache* cache, unsigned long hash, size_t len,
+                    unsigned long *score){
+
+    struct score_cache_entry* entry = &cache->entries[hash & cache->mask];
+
+    unsigned long sequence = atomic_load_explicit(&entry->sequence,
+                                                  memory_order_acquire);
+    if ((sequence & 1) == 0){
+        unsigned long entry_hash = atomic_load_explicit(&entry->hash,
+                                                        memory_order_relaxed);
+        unsigned long entry_len = atomic_load_explicit(&entry->key_len,
+                                                       memory_order_relaxed);
+        unsigned long entry_score = atomic_load_explicit(&entry->score,
+                                                         memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if ((entry_hash == hash) && (entry_len == (len + 1))
+            && (atomic_load_explicit(&entry->sequence,
+                                     memory_order_relaxed) == sequence)){
+
+            atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+            *score = entry_score;
+            return 1;
+        }
+    }
+
+    atomic_fetch_add_explicit(&cache->misses, 1, memory_order_relaxed);
+    return 0;
+}
+
+
+void score_cache_put(score_cache* cache, unsigned long hash, size_t len,
+                     unsigned long score){
+
+    struct score_cache_entry* entry = &cache->entries[hash & cache->mask];
+
+    unsigned long sequence = atomic_load_explicit(&entry->sequence,
+                                                  memory_order_relaxed);
+    if ((sequence & 1)
+        || !atomic_compare_exchange_strong_explicit(&entry->sequence,
+                                                    &sequence, sequence + 1,
+                                                    memory_order_acquire,
+                                                    memory_order_relaxed)){
+        return; // Someone else is writing it
+    }
+    atomic_thread_fence(memory_order_release);
+
+    unsigned long entry_len = atomic_load_explicit(&entry->key_len,
+                                                   memory_order_relaxed);
+    if ((entry_len != 0)
+        && ((entry_len != (len + 1))
+            || (atomic_load_explicit(&entry->hash,
+                                     memory_order_relaxed) != hash))){
+
+        atomic_fetch_add_explicit(&cache->evictions, 1, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&entry->hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&entry->key_len, len + 1, memory_order_relaxed);
+    atomic_store_explicit(&entry->score, score, memory_order_relaxed);
+
+    atomic_store_explicit(&entry->sequence, sequence + 2, memory_order_release);
+}
+
+
+void get_score_cache_stats(const score_cache* cache, score_cache_stats* stats){
+    assert(cache != NULL);
+
+    stats->hits = atomic_load(&cache->hits);
+    stats->misses = atomic_load(&cache->misses);
+    stats->evictions = atomic_load(&cache->evictions);
+    stats->entries = cache->mask + 1;
+}
+
+
+void clear_score_cache(score_cache* cache){
+    memset(cache->entries, 0,
+           (cache->mask + 1) * sizeof(struct score_cache_entry));
+}
@@ -0,0 +1,37 @@
+#ifndef LANG_MODEL_SCORE_CACHE_H
+#define LANG_MODEL_SCORE_CACHE_H
+
+#include <stddef.h>
+
+/*
+ * Fixed-size, direct-mapped output -> score cache.
+ *
+ * Entries are keyed by the hash of the output bytes and their length, the
+ * bytes themselves are not stored. Lookups are lock-free (a per-entry
+ * sequence number detects concurrent writes) and a writer that finds an
+ * entry being written simply skips the insertion, so any number of
+ * evaluator threads can share a cache.
+ */
+typedef struct score_cache score_cache;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    size_t entries;
+} score_cache_stats;
+
+score_cache* create_score_cache(size_t bytes);
+void free_score_cache(score_cache* cache);
+
+int score_cache_get(score_cache* cache, unsigned long hash, size_t len,
+                    unsigned long *score);
+void score_cache_put(score_cache* cache, unsigned long hash, size_t len,
+                     unsigned long score);
+
+void get_score_cache_stats(const score_cache* cache, score_cache_stats* stats);
+
+// Empties the cache, not to be called while others use it
+void clear_score_cache(score_cache* cache);
+
+#endif
@@ -4,6 +4,7 @@
 #define EVOLVE_CONTINUE 0
 #define EVOLVE_DONE 1
 #define EVOLVE_SHAKE 2
+#define EVOLVE_BUMP 3  /* a shake, reported apart in the metrics */
 
 
 #endif
@@ -3,13 +3,115 @@
 
 #include <stdio.h>
 #include "../lang-model/model.h"
+#include "profile.h"
 
 typedef struct transform_model transform_model;
 
+typedef enum {
+    EVOLVE_METRICS_JSON,  // one object per line
+    EVOLVE_METRICS_CSV,   // with a header line
+} evolve_metrics_format;
+
+typedef struct {
+    // Generations between progress lines on stdout, 0 for none
+    int show_interval;
+
+    // Descriptor receiving a line of metrics per generation, -1 for none
+    int metrics_fd;
+    evolve_metrics_format metrics_format;
+
+    /*
+     * Generations between reports (on stderr) of the hardware counters of
+     * the interpreter, scoring and variation phases, 0 for none.
+     */
+    int perf_interval;
+
+    /*
+     * Generations between reports (on stderr) of the allocations of every
+     * module, 0 for none. Needs a build with ALLOC_STATS.
+     */
+    int alloc_interval;
+
+    // Adds the interpreter runs of the population to it, if not NULL
+    interpreter_profile* profile;
+
+    /*
+     * Staged evaluation, for long texts: every individual first runs on
+     * the first `screen_prefix` bytes (0 for no staging) with at most
+     * `screen_cycles` cycles. Only the best `screen_promote` share of the
+     * population, those scoring `screen_margin` of the best screening or
+     * more (0 for none) and the elite run on the whole text.
+     */
+    size_t screen_prefix;
+    unsigned long screen_cycles;
+    double screen_promote;
+    double screen_margin;
+
+    /*
+     * Racing evaluation, when not staged: everybody runs `race_cycles`
+     * cycles (0 for no racing) and is scored on the output so far, then
+     * the better half runs twice as long, and so on down to `race_keep`
+     * individuals, which run in full. Runs are resumed, not restarted.
+     * Racing runs can't be profiled, leave `profile` NULL when racing.
+     */
+    unsigned long race_cycles;
+    int race_keep;
+
+    /*
+     * Generations between audits of the staged or racing evaluation (0 for
+     * none), which evaluate everybody in full to report in the metrics the
+     * work saved and how the ranking changed.
+     */
+    int audit_interval;
+
+    /*
+     * Steady-state evolution with this many evaluating threads (0 for
+     * generations in lockstep): offspring bred by the calling thread are
+     * evaluated as soon as a thread is free and replace the worst of a
+     * tournament. Every population size evaluations count as a generation
+     * for the controller and the metrics. Evaluation is always in full,
+     * without profile, hardware counters or allocation reports.
+     */
+    int steady_workers;
+} evolve_options;
+
+void evolve_default_options(evolve_options* options);
+
+// Work done by an evolution, filled as it runs
+typedef struct {
+    unsigned long generations;
+    unsigned long evaluations;  /* on the whole text */
+    unsigned long screenings;   /* staged or racing evaluation only */
+} evolve_stats;
+
 char *process(transform_model* transform,
               const char* input,
               const language_model* model);
 
+// Same as `process`, adding the run to `profile` (which may be NULL)
+char *process_profiled(transform_model* transform,
+                       const char* input,
+                       const language_model* model,
+                       interpreter_profile* profile);
+
+
+// What a `stream_transform` went through
+typedef struct {
+    unsigned long bytes_in;
+    unsigned long bytes_out;
+    unsigned long cycles;
+    int crashed;
+    int capped;
+} stream_stats;
+
+/*
+ * Runs the transform from `in` to `out` as they go, for inputs of any size.
+ * Every byte read adds `cycles_per_byte` to the cycle budget of `process`.
+ * Returns -1 on read or write errors.
+ */
+int stream_transform(transform_model* transform, FILE* in, FILE* out,
+                     unsigned long cycles_per_byte, stream_stats* stats);
+
 
 transform_model* transform_from_program(char *program);
 
@@ -20,8 +122,24 @@ transform_model* evolve_transform(
         int iteration, transform_model* transform,
         const char* better_output, unsigned long score));
 
+transform_model* evolve_transform_with_options(
+    const language_model* model, const char* text,
+    int (*controller) (
+        int iteration, transform_model* transform,
+        const char* better_output, unsigned long score),
+    const evolve_options* options, evolve_stats* stats);
+
+
+// Interpreter cycles run by the last `process` of the transform
+unsigned long transform_model_cycles(const transform_model* model);
+
+// Score given by the last `process` with a language model
+long transform_model_score(const transform_model* model);
 
 void free_transform_model(transform_model* model);
 void show_transform_model(transform_model* model);
 
+// Same as `show_transform_model`, to any file
+void write_transform_model(transform_model* model, FILE* f);
+
 #endif
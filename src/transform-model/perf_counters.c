@@ -0,0 +1,187 @@
+#include "perf_counters.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HW_CACHE_READ_MISS(cache) ((cache)                              \
+                                   | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+                                   | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} PERF_EVENTS[PERF_COUNTER_COUNT] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "branch-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "L1d-miss", PERF_TYPE_HW_CACHE, HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { "LLC-miss", PERF_TYPE_HW_CACHE, HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { "dTLB-miss", PERF_TYPE_HW_CACHE, HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+    { "task-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+struct perf_counters {
+    int fds[PERF_COUNTER_COUNT];  /* -1 for unavailable counters */
+    int phase_count;
+    uint64_t mark[PERF_COUNTER_COUNT];
+    uint64_t* totals;             /* phase_count rows of PERF_COUNTER_COUNT */
+};
+
+
+static int open_counter(uint32_t type, uint64_t config){
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+
+perf_counters* open_perf_counters(int phase_count){
+    perf_counters* counters = malloc(sizeof(perf_counters));
+    if (counters == NULL){
+        return NULL;
+    }
+
+    counters->phase_count = phase_count;
+    counters->totals = calloc(phase_count * PERF_COUNTER_COUNT, sizeof(uint64_t));
+    if (counters->totals == NULL){
+        free(counters);
+        return NULL;
+    }
+
+    int i, opened = 0, first_error = 0;
+    for (i = 0; i < PERF_COUNTER_COUNT; i++){
+        counters->fds[i] = open_counter(PERF_EVENTS[i].type,
+                                        PERF_EVENTS[i].config);
+        if (counters->fds[i] >= 0){
+            opened++;
+        }
+        else if (first_error == 0){
+            first_error = errno;
+        }
+        counters->mark[i] = 0;
+    }
+
+    if (opened == 0){
+        close_perf_counters(counters);
+        errno = first_error;
+        return NULL;
+    }
+
+    return counters;
+}
+
+
+void close_perf_counters(perf_counters* counters){
+    if (counters == NULL){
+        return;
+    }
+
+    int i;
+    for (i = 0; i < PERF_COUNTER_COUNT; i++){
+        if (counters->fds[i] >= 0){
+            close(counters->fds[i]);
+        }
+    }
+
+    free(counters->totals);
+    free(counters);
+}
+
+
+// Counter value, scaled up if the kernel multiplexed it
+static uint64_t read_counter(int fd){
+    uint64_t data[3];  /* value, time enabled, time running */
+
+    if (read(fd, data, sizeof(data)) != sizeof(data)){
+        return 0;
+    }
+
+    if ((data[2] > 0) && (data[2] < data[1])){
+        return (uint64_t) ((double) data[0] * data[1] / data[2]);
+    }
+
+    return data[0];
+}
+
+
+void begin_perf_phase(perf_counters* counters){
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++){
+        if (counters->fds[i] >= 0){
+            counters->mark[i] = read_counter(counters->fds[i]);
+        }
+    }
+}
+
+
+void end_perf_phase(perf_counters* counters, int phase){
+    uint64_t* totals = &counters->totals[phase * PERF_COUNTER_COUNT];
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++){
+        if (counters->fds[i] >= 0){
+            uint64_t value = read_counter(counters->fds[i]);
+
+            // Scaling can make consecutive readings go back
+            if (value > counters->mark[i]){
+                totals[i] += value - counters->mark[i];
+            }
+            counters->mark[i] = value;
+        }
+    }
+}
+
+
+void report_perf_counters(perf_counters* counters, FILE* f, const char* title,
+                          const char* const* phase_names){
+    int phase, i;
+
+    fprintf(f, "%-10s", title);
+    for (i = 0; i < PERF_COUNTER_COUNT; i++){
+        fprintf(f, " %14s", PERF_EVENTS[i].name);
+    }
+    fprintf(f, " %6s\n", "IPC");
+
+    for (phase = 0; phase < counters->phase_count; phase++){
+        uint64_t* totals = &counters->totals[phase * PERF_COUNTER_COUNT];
+
+        fprintf(f, "%-10s", phase_names[phase]);
+        for (i = 0; i < PERF_COUNTER_COUNT; i++){
+            if (counters->fds[i] >= 0){
+                fprintf(f, " %14lu", (unsigned long) totals[i]);
+            }
+            else {
+                fprintf(f, " %14s", "n/a");
+            }
+        }
+
+        if ((counters->fds[PERF_CYCLES] >= 0)
+            && (counters->fds[PERF_INSTRUCTIONS] >= 0)
+            && (totals[PERF_CYCLES] > 0)){
+
+            fprintf(f, " %6.2f\n",
+                    (double) totals[PERF_INSTRUCTIONS] / totals[PERF_CYCLES]);
+        }
+        else {
+            fprintf(f, " %6s\n", "n/a");
+        }
+    }
+
+    memset(counters->totals, 0,
+           sizeof(uint64_t) * counters->phase_count * PERF_COUNTER_COUNT);
+}
@@ -0,0 +1,47 @@
+#ifndef TRANSFORM_MODEL_PERF_COUNTERS_H
+#define TRANSFORM_MODEL_PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Hardware counters (Linux perf_event_open) of the calling thread,
+ * accounted to the phases of a loop: every `end_perf_phase` adds what was
+ * counted since the previous `begin_perf_phase` to that phase.
+ *
+ * Counters the kernel, the CPU or the permissions don't allow are left
+ * out and reported as unavailable; virtual machines often lack the
+ * hardware ones and keep only the task clock.
+ */
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_TASK_CLOCK,  /* software, in ns: works where the others don't */
+    PERF_COUNTER_COUNT
+} perf_counter;
+
+typedef struct perf_counters perf_counters;
+
+/*
+ * Returns NULL, with errno set by the first failed counter, if none of
+ * the counters can be opened.
+ */
+perf_counters* open_perf_counters(int phase_count);
+void close_perf_counters(perf_counters* counters);
+
+void begin_perf_phase(perf_counters* counters);
+void end_perf_phase(perf_counters* counters, int phase);
+
+/*
+ * Writes the per phase totals since the last report, as a table titled
+ * `title`, and clears them.
+ */
+void report_perf_counters(perf_counters* counters, FILE* f, const char* title,
+                          const char* const* phase_names);
+
+#endif
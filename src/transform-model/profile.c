@@ -0,0 +1,138 @@
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_HOT_POSITIONS 10
+
+static const char* PROFILE_OPCODES = ".,+-<>[]";
+
+
+interpreter_profile* create_interpreter_profile(){
+    return calloc(1, sizeof(interpreter_profile));
+}
+
+
+void free_interpreter_profile(interpreter_profile* profile){
+    free(profile);
+}
+
+
+static double share(unsigned long part, unsigned long whole){
+    return whole > 0 ? (100.0 * part) / whole : 0;
+}
+
+
+// Lowest trip count of a bucket
+static unsigned long bucket_min(int bucket){
+    return bucket == 0 ? 0 : 1UL << (bucket - 1);
+}
+
+
+void write_interpreter_profile(const interpreter_profile* profile, FILE* f){
+    int i, j;
+
+    fprintf(f, "Interpreter profile: %lu runs, %lu cycles "
+            "(%.1f per run), %lu capped, %lu crashed\n",
+            profile->runs, profile->cycles,
+            profile->runs > 0 ? (double) profile->cycles / profile->runs : 0,
+            profile->capped, profile->crashed);
+
+    fprintf(f, "\n  opcode %16s %8s\n", "executed", "share");
+    for (i = 0; PROFILE_OPCODES[i] != '\0'; i++){
+        unsigned long count = profile->opcodes[(unsigned char) PROFILE_OPCODES[i]];
+
+        fprintf(f, "  %6c %16lu %7.2f%%\n", PROFILE_OPCODES[i], count,
+                share(count, profile->cycles));
+    }
+
+    unsigned long loops = 0;
+    for (i = 0; i < PROFILE_TRIP_BUCKETS; i++){
+        loops += profile->trips[i];
+    }
+
+    fprintf(f, "\n  loop trips %12s %8s\n", "loops", "share");
+    for (i = 0; i < PROFILE_TRIP_BUCKETS; i++){
+        if (profile->trips[i] == 0){
+            continue;
+        }
+
+        char range[32];
+        if (i < 2){
+            snprintf(range, sizeof(range), "%lu", bucket_min(i));
+        }
+        else if (i == PROFILE_TRIP_BUCKETS - 1){
+            snprintf(range, sizeof(range), "%lu+", bucket_min(i));
+        }
+        else {
+            snprintf(range, sizeof(range), "%lu-%lu", bucket_min(i),
+                     bucket_min(i + 1) - 1);
+        }
+        fprintf(f, "  %10s %12lu %7.2f%%\n", range, profile->trips[i],
+                share(profile->trips[i], loops));
+    }
+
+    // Selection of the hottest positions, the table is small
+    int hot[PROFILE_HOT_POSITIONS];
+    int hot_count = 0;
+    for (i = 0; i < PROFILE_POSITIONS; i++){
+        if (profile->positions[i] == 0){
+            continue;
+        }
+
+        for (j = hot_count; (j > 0)
+                 && (profile->positions[hot[j - 1]] < profile->positions[i]); j--){
+            if (j < PROFILE_HOT_POSITIONS){
+                hot[j] = hot[j - 1];
+            }
+        }
+        if (j < PROFILE_HOT_POSITIONS){
+            hot[j] = i;
+            if (hot_count < PROFILE_HOT_POSITIONS){
+                hot_count++;
+            }
+        }
+    }
+
+    fprintf(f, "\n  position %14s %8s\n", "cycles", "share");
+    for (i = 0; i < hot_count; i++){
+        fprintf(f, "  %8i %14lu %7.2f%%\n", hot[i], profile->positions[hot[i]],
+                share(profile->positions[hot[i]], profile->cycles));
+    }
+
+    fprintf(f, "\n  tape reallocations: '<' %lu (%.3f per run), '>' %lu\n",
+            profile->left_reallocs,
+            profile->runs > 0 ? (double) profile->left_reallocs / profile->runs : 0,
+            profile->right_reallocs);
+}
+
+
+void dump_interpreter_profile(const interpreter_profile* profile, FILE* f){
+    int i, last;
+
+    fprintf(f, "{\"runs\": %lu, \"cycles\": %lu, \"capped\": %lu, "
+            "\"crashed\": %lu,\n \"opcodes\": {",
+            profile->runs, profile->cycles, profile->capped, profile->crashed);
+    for (i = 0; PROFILE_OPCODES[i] != '\0'; i++){
+        fprintf(f, "%s\"%c\": %lu", i > 0 ? ", " : "", PROFILE_OPCODES[i],
+                profile->opcodes[(unsigned char) PROFILE_OPCODES[i]]);
+    }
+
+    fprintf(f, "},\n \"loop_trips\": [");
+    for (i = 0; i < PROFILE_TRIP_BUCKETS; i++){
+        fprintf(f, "%s{\"min\": %lu, \"loops\": %lu}", i > 0 ? ", " : "",
+                bucket_min(i), profile->trips[i]);
+    }
+
+    // Positions up to the last one reached
+    for (last = PROFILE_POSITIONS - 1;
+         (last >= 0) && (profile->positions[last] == 0); last--);
+
+    fprintf(f, "],\n \"positions\": [");
+    for (i = 0; i <= last; i++){
+        fprintf(f, "%s%lu", i > 0 ? ", " : "", profile->positions[i]);
+    }
+
+    fprintf(f, "],\n \"left_reallocs\": %lu, \"right_reallocs\": %lu}\n",
+            profile->left_reallocs, profile->right_reallocs);
+}
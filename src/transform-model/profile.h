@@ -0,0 +1,59 @@
+#ifndef TRANSFORM_MODEL_PROFILE_H
+#define TRANSFORM_MODEL_PROFILE_H
+
+#include <stdio.h>
+
+/*
+ * What the interpreter did over many runs: executed opcodes, cycles per
+ * program position, trip counts of the loops and tape reallocations.
+ * Only the profiled interpreter entry points fill it, the plain ones
+ * don't pay for it.
+ */
+
+// Programs longer than this add their tail to the last position
+#define PROFILE_POSITIONS 2048
+
+// Loops by trip count: 0, 1, 2-3, 4-7... up to 2^(buckets - 2) or more
+#define PROFILE_TRIP_BUCKETS 22
+
+// Deepest loop nesting the interpreter runs
+#define PROFILE_MAX_LOOP_DEPTH 256
+
+typedef struct interpreter_profile {
+    unsigned long runs;
+    unsigned long cycles;
+    unsigned long capped;
+    unsigned long crashed;
+
+    unsigned long opcodes[256];
+    unsigned long positions[PROFILE_POSITIONS];
+    unsigned long trips[PROFILE_TRIP_BUCKETS];
+
+    unsigned long left_reallocs;   /* '<' past the tape start, copies it */
+    unsigned long right_reallocs;  /* '>' past the tape end, reallocs it */
+
+    // Scratch, trip counts of the loops open in the current run
+    unsigned long trip_stack[PROFILE_MAX_LOOP_DEPTH];
+} interpreter_profile;
+
+interpreter_profile* create_interpreter_profile();
+void free_interpreter_profile(interpreter_profile* profile);
+
+static inline void profile_loop_trips(interpreter_profile* profile,
+                                      unsigned long trips){
+    int bucket = 0;
+
+    while ((trips > 0) && (bucket < PROFILE_TRIP_BUCKETS - 1)){
+        trips >>= 1;
+        bucket++;
+    }
+    profile->trips[bucket]++;
+}
+
+// Human readable summary
+void write_interpreter_profile(const interpreter_profile* profile, FILE* f);
+
+// Everything, as a JSON object
+void dump_interpreter_profile(const interpreter_profile* profile, FILE* f);
+
+#endif
@@ -1,12 +1,24 @@
 #include "model.h"
 #include "../lang-model/model.h"
 #include "controller.h"
+#include "perf_counters.h"
+#include "profile.h"
 
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../ht/hash.h"
+
+#define ALLOC_MODULE ALLOC_TRANSFORM
+#include "../ht/alloc_stats.h"
 
 const char* PROGRAM_OPTIONS = ".,+-<>[]";
 #define PROGRAM_OPTION_COUNT 8
@@ -15,11 +27,53 @@ const int PROGRAM_SIZE = 512;
 const int POPULATION_SIZE = 128;
 #define MAX_CYCLES 1000000
 #define SHOW_INTERVAL 20
+// Audits of the staged evaluation check the promotion of this many best
+#define SCREEN_AUDIT_ELITE (POPULATION_SIZE / 16)
+#define SCREEN_CYCLES 20000
+#define SCREEN_PROMOTE 0.25
+#define SCREEN_MARGIN 0.9
+#define RACE_KEEP (POPULATION_SIZE / 8)
+#define STEADY_TOURNAMENT 4
+#define STEADY_QUEUE_PER_WORKER 16
+
+// Interpreter runs and scoring of one evaluation stage
+struct evaluation_work {
+    double eval_seconds;
+    double score_seconds;
+    unsigned long cycles;
+    int crashed;
+    int capped;
+};
+
+// Where the time and cycles of a generation went, for the metrics stream
+struct generation_metrics {
+    struct evaluation_work full;
+    struct evaluation_work screen;  /* staged evaluation only */
+    int promoted;                   /* individuals evaluated in full */
+    int race_rounds;                /* racing evaluation only */
+    double selection_seconds;
+    double variation_seconds;
+    int distinct;
+    long best, median, worst;
+
+    // Staged evaluation checked against a full one
+    int audited;
+    double audit_saved;             /* share of the interpreter cycles */
+    double audit_recall;            /* of the elite, promoted */
+    int audit_best_kept;
+    double audit_rank_correlation;  /* screening vs full scores */
+};
+
+const char* EVOLVE_ACTION_NAMES[] = { "continue", "done", "shake", "bump" };
+
+enum evolve_phase { PHASE_PROCESS, PHASE_SCORE, PHASE_VARIATION, PHASE_COUNT };
+const char* const EVOLVE_PHASE_NAMES[] = { "process", "score", "variation" };
 
 struct transform_model {
     long score;
     size_t output_size;
     size_t program_size;
+    unsigned long cycles;
     char* program;
 };
 
@@ -29,6 +83,7 @@ transform_model* new_model(){
     model->output_size = -2;
     model->score = -2;
     model->program_size = -2;
+    model->cycles = 0;
     model->program = NULL;
     return model;
 }
@@ -69,6 +124,7 @@ transform_model* copy_model(transform_model* source){
     }
 
     transform->program_size = source->program_size;
+    transform->cycles = 0;
 
     return transform;
 }
@@ -132,40 +188,135 @@ int inv_language_score_cmp(const void* _model1,
 }
 
 
-char* process(transform_model* transform,
-              const char* input,
-              const language_model* model){
+#define MAX_LOOP_DEPTH 256
+
+/*
+ * A run of the interpreter, which can be stopped when it reaches a cycle
+ * budget and resumed later with a larger one.
+ */
+struct program_run {
+    const char* input;
+    int input_length;
+    int input_i;
+
+    unsigned long ip;
+    unsigned long counter;
+    int depth;
+    int loop_stack[MAX_LOOP_DEPTH];
+
+    unsigned char* mem;
+    int mem_size;
+    int mem_dir;
+
+    char* output;
+    int output_size;
+    int output_heap_size;
+
+    int crashed;
+};
+
+
+static void start_program_run(struct program_run* run, const char* input){
+    run->input = input;
+    run->input_length = strlen(input);
+    run->input_i = 0;
+
+    run->ip = run->counter = 0;
+    run->depth = 0;
+
+    run->output_size = 0;
+    run->output_heap_size = 128;
+    run->output = malloc(sizeof(char) * run->output_heap_size);
+
+    run->mem_size = 128;
+    run->mem = malloc(sizeof(char) * run->mem_size);
+    assert(run->mem != NULL);
+    memset(run->mem, 0, sizeof(char) * run->mem_size);
+    run->mem_dir = 0;
+
+    run->crashed = 0;
+}
+
+
+/*
+ * Input and output of a run over streams: ',' reads the input as it is
+ * needed and '.' writes to the output right away, so nothing grows with
+ * the input but the cycle budget.
+ */
+struct program_stream {
+    FILE* in;
+    FILE* out;
+    unsigned long cycles_per_byte;  /* budget added by every byte read */
+
+    unsigned long bytes_in;
+    unsigned long bytes_out;
+    int input_done;
+};
+
+
+static int program_run_finished(const struct program_run* run,
+                                const transform_model* transform){
+    return run->ip >= transform->program_size;
+}
+
+
+/*
+ * The interpreter, running until the program ends or `max_cycles` cycles
+ * are spent in total. Inlined in a plain, a profiled and a streaming
+ * version: with a NULL profile or stream their branches fold away.
+ * Profiles count loop trips of whole runs, so profiled runs are never
+ * resumed.
+ */
+static inline __attribute__((always_inline))
+void run_slice(struct program_run* run,
+               transform_model* transform,
+               unsigned long max_cycles,
+               interpreter_profile* profile,
+               struct program_stream* stream){
 
     assert(transform != NULL);
     assert(transform->program != NULL);
 
-    int input_length = strlen(input);
-    const unsigned long max_cycles = MAX_CYCLES;
-    const int max_depth = 256;
-    int depth = 0;
-    int loop_stack[max_depth];
+    const char* input = run->input;
+    int input_length = run->input_length;
+    const int max_depth = MAX_LOOP_DEPTH;
+    int depth = run->depth;
+    int* loop_stack = run->loop_stack;
 
-    int output_size = 0;
-    int output_heap_size = 128;
-    char* output = malloc(sizeof(char) * output_heap_size);
+    // Loop trips, profiling only: entries of the open loops (kept in the
+    // profile), and of the loop whose ']' just jumped back to its '['
+    unsigned long* trip_stack = profile != NULL ? profile->trip_stack : NULL;
+    unsigned long back_trips = 0;
+    int loop_back = 0;
 
-    int mem_size = 128;
-    unsigned char* mem = malloc(sizeof(char) * mem_size);
-    assert(mem != NULL);
-    memset(mem, 0, sizeof(char) * mem_size);
+    int output_size = run->output_size;
+    int output_heap_size = run->output_heap_size;
+    char* output = run->output;
 
-    int crashed = 0;
-    int input_i = 0;
-    int mem_dir = 0;
+    int mem_size = run->mem_size;
+    unsigned char* mem = run->mem;
 
-    unsigned long counter;
-    unsigned long ip;
+    int crashed = run->crashed;
+    int input_i = run->input_i;
+    int mem_dir = run->mem_dir;
+
+    unsigned long counter = run->counter;
+    unsigned long ip = run->ip;
 
     assert(transform->program_size >= 0);
 
-    for (ip = counter = 0;(ip < transform->program_size) && (counter < max_cycles);
+    for (;(ip < transform->program_size) && (counter < max_cycles);
          counter++){
 
+        int came_back = 0;
+        if (profile != NULL){
+            profile->opcodes[(unsigned char) transform->program[ip]]++;
+            profile->positions[ip < PROFILE_POSITIONS ? ip : PROFILE_POSITIONS - 1]++;
+
+            came_back = loop_back;
+            loop_back = 0;
+        }
+
         switch(transform->program[ip++]){
         case '+':
             mem[mem_dir] = (mem[mem_dir] + 1) & 0xFF;
@@ -178,6 +329,9 @@ char* process(transform_model* transform,
         case '<':
             mem_dir--;
             if (mem_dir < 0){
+                if (profile != NULL){
+                    profile->left_reallocs++;
+                }
 
                 unsigned char* new_mem = malloc(sizeof(char) * (mem_size + 128));
                 memset(new_mem, 0, sizeof(char) * 128);
@@ -196,6 +350,10 @@ char* process(transform_model* transform,
         case '>':
             mem_dir++;
             if (mem_dir >= mem_size){
+                if (profile != NULL){
+                    profile->right_reallocs++;
+                }
+
                 mem = realloc(mem, sizeof(char) * (mem_size + 128));
                 memset(&mem[mem_size], 0, sizeof(char) * 128);
 
@@ -219,12 +377,18 @@ char* process(transform_model* transform,
                     }
                 }
 
+                if (profile != NULL){
+                    profile_loop_trips(profile, came_back ? back_trips : 0);
+                }
             }
             else if (depth >= max_depth){ // Crash program
                 ip = transform->program_size;
                 crashed = 1;
             }
             else {
+                if (profile != NULL){
+                    trip_stack[depth] = came_back ? back_trips + 1 : 1;
+                }
                 loop_stack[depth++] = ip - 1;
             }
             break;
@@ -237,14 +401,37 @@ char* process(transform_model* transform,
             else {
                 unsigned long end_ip = ip - 1;
                 ip = loop_stack[--depth];
+                if (profile != NULL){
+                    back_trips = trip_stack[depth];
+                    loop_back = 1;
+                }
+
                 if (end_ip == (ip + 1)){ // break off [] loop
                     ip = transform->program_size;
+
+                    if (profile != NULL){
+                        profile_loop_trips(profile, back_trips);
+                        loop_back = 0;
+                    }
                 }
             }
             break;
 
         case ',':
-            if (input_i < input_length){
+            if (stream != NULL){
+                int c = stream->input_done ? EOF : getc(stream->in);
+
+                if (c == EOF){
+                    stream->input_done = 1;
+                    mem[mem_dir] = '\0';
+                }
+                else {
+                    mem[mem_dir] = c;
+                    stream->bytes_in++;
+                    max_cycles += stream->cycles_per_byte;
+                }
+            }
+            else if (input_i < input_length){
                 mem[mem_dir] = input[input_i++];
             }
             else {
@@ -256,6 +443,14 @@ char* process(transform_model* transform,
             if (mem[mem_dir] == '\0'){  // End program on \0
                 ip = transform->program_size;
             }
+            if (stream != NULL){
+                // The ending '\0' isn't part of the output
+                if (mem[mem_dir] != '\0'){
+                    putc(mem[mem_dir], stream->out);
+                    stream->bytes_out++;
+                }
+                break;
+            }
             if ((output_size + 1) >= output_heap_size){
                 output_heap_size += 128;
                 output = realloc(output, sizeof(char) * output_heap_size);
@@ -269,18 +464,430 @@ char* process(transform_model* transform,
 
     output[output_size] = '\0';
 
-    if (model != NULL){
-        transform->score = language_model_score(model, output) / (crashed + 1)
-            + ((!crashed) && (output_size != 0));
+    if (profile != NULL){
+        // Loops cut by the end of the program count as they are
+        int i;
+        for (i = 0; i < depth; i++){
+            profile_loop_trips(profile, trip_stack[i]);
+        }
+        if (loop_back){
+            profile_loop_trips(profile, back_trips);
+        }
+
+        profile->runs++;
+        profile->cycles += counter;
+        profile->capped += counter >= max_cycles;
+        profile->crashed += crashed;
     }
 
-    transform->output_size = output_size;
+    run->depth = depth;
+    run->output_size = output_size;
+    run->output_heap_size = output_heap_size;
+    run->output = output;
+    run->mem_size = mem_size;
+    run->mem = mem;
+    run->crashed = crashed;
+    run->input_i = input_i;
+    run->mem_dir = mem_dir;
+    run->counter = counter;
+    run->ip = ip;
+}
 
-    free(mem);
+
+// Ends a run, leaving its results in the transform. Returns the output.
+static char* finish_program_run(struct program_run* run,
+                                transform_model* transform,
+                                int* crashed_flag){
+
+    transform->output_size = run->output_size;
+    transform->cycles = run->counter;
+    *crashed_flag = run->crashed;
+
+    free(run->mem);
+
+    return run->output;
+}
+
+
+static inline __attribute__((always_inline))
+char* run_program(transform_model* transform,
+                  const char* input,
+                  unsigned long max_cycles,
+                  int* crashed_flag,
+                  interpreter_profile* profile){
+
+    struct program_run run;
+
+    start_program_run(&run, input);
+    run_slice(&run, transform, max_cycles, profile, NULL);
+
+    return finish_program_run(&run, transform, crashed_flag);
+}
+
+
+static char* execute(transform_model* transform,
+                     const char* input,
+                     unsigned long max_cycles,
+                     int* crashed_flag){
+
+    return run_program(transform, input, max_cycles, crashed_flag, NULL);
+}
+
+
+static char* execute_profiled(transform_model* transform,
+                              const char* input,
+                              unsigned long max_cycles,
+                              int* crashed_flag,
+                              interpreter_profile* profile){
+
+    return run_program(transform, input, max_cycles, crashed_flag, profile);
+}
+
+
+static long crash_adjusted_score(const transform_model* transform,
+                                 int crashed, unsigned long score){
+
+    return score / (crashed + 1)
+        + ((!crashed) && (transform->output_size != 0));
+}
+
+
+// Length of the scored text, a program ending on '\0' outputs it too
+static size_t output_text_length(const transform_model* transform,
+                                 const char* output){
+
+    size_t size = transform->output_size;
+
+    if ((size > 0) && (output[size - 1] == '\0')){
+        size--;
+    }
+
+    return size;
+}
+
+
+char* process(transform_model* transform,
+              const char* input,
+              const language_model* model){
+
+    return process_profiled(transform, input, model, NULL);
+}
+
+
+char* process_profiled(transform_model* transform,
+                       const char* input,
+                       const language_model* model,
+                       interpreter_profile* profile){
+
+    int crashed;
+    char* output = profile != NULL
+        ? execute_profiled(transform, input, MAX_CYCLES, &crashed, profile)
+        : execute(transform, input, MAX_CYCLES, &crashed);
+
+    if (model != NULL){
+        transform->score = crash_adjusted_score(
+            transform, crashed,
+            language_model_score_n(model, output,
+                                   output_text_length(transform, output)));
+    }
 
     return output;
 }
 
+
+// The interpreter over streams, see `struct program_stream`
+int stream_transform(transform_model* transform, FILE* in, FILE* out,
+                     unsigned long cycles_per_byte, stream_stats* stats){
+
+    struct program_stream stream = {
+        .in = in,
+        .out = out,
+        .cycles_per_byte = cycles_per_byte,
+    };
+    struct program_run run;
+    int crashed;
+
+    start_program_run(&run, "");
+    run_slice(&run, transform, MAX_CYCLES, NULL, &stream);
+    free(finish_program_run(&run, transform, &crashed));
+
+    stats->bytes_in = stream.bytes_in;
+    stats->bytes_out = stream.bytes_out;
+    stats->cycles = transform->cycles;
+    stats->crashed = crashed;
+    stats->capped = transform->cycles
+        >= MAX_CYCLES + stream.bytes_in * cycles_per_byte;
+
+    return (ferror(in) || ferror(out)) ? -1 : 0;
+}
+
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Runs and scores some individuals, adding the work done to `work`
+static void run_and_score(transform_model* individuals[], int count,
+                          const char* text, unsigned long max_cycles,
+                          const language_model* model,
+                          struct evaluation_work* work,
+                          perf_counters* perf,
+                          interpreter_profile* profile){
+
+    char* outputs[POPULATION_SIZE];
+    size_t lengths[POPULATION_SIZE];
+    int crashed[POPULATION_SIZE];
+    unsigned long scores[POPULATION_SIZE];
+
+    assert(count <= POPULATION_SIZE);
+
+    if (perf != NULL){
+        begin_perf_phase(perf);
+    }
+
+    double start = now();
+    int i;
+    for (i = 0; i < count; i++){
+        outputs[i] = profile != NULL
+            ? execute_profiled(individuals[i], text, max_cycles, &crashed[i],
+                               profile)
+            : execute(individuals[i], text, max_cycles, &crashed[i]);
+        lengths[i] = output_text_length(individuals[i], outputs[i]);
+
+        work->cycles += individuals[i]->cycles;
+        work->crashed += crashed[i];
+        work->capped += individuals[i]->cycles >= max_cycles;
+    }
+    double scoring = now();
+    work->eval_seconds += scoring - start;
+
+    if (perf != NULL){
+        end_perf_phase(perf, PHASE_PROCESS);
+    }
+
+    language_model_score_batch(model, (const char**) outputs, lengths,
+                               count, scores);
+    work->score_seconds += now() - scoring;
+
+    if (perf != NULL){
+        end_perf_phase(perf, PHASE_SCORE);
+    }
+
+    for (i = 0; i < count; i++){
+        individuals[i]->score = crash_adjusted_score(individuals[i], crashed[i],
+                                                     scores[i]);
+        free(outputs[i]);
+    }
+}
+
+
+static void evaluate_population(transform_model* population[],
+                                const char* text,
+                                const language_model* model,
+                                struct generation_metrics* metrics,
+                                perf_counters* perf,
+                                interpreter_profile* profile){
+
+    run_and_score(population, POPULATION_SIZE, text, MAX_CYCLES, model,
+                  &metrics->full, perf, profile);
+    metrics->promoted = POPULATION_SIZE;
+}
+
+
+// Average ranks of the scores, best first: ties share the mean of theirs
+static void score_ranks(const long scores[], double ranks[]){
+    int i, j;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        int above = 0, equal = 0;
+
+        for (j = 0; j < POPULATION_SIZE; j++){
+            above += scores[j] > scores[i];
+            equal += scores[j] == scores[i];
+        }
+        ranks[i] = above + (equal - 1) / 2.0;
+    }
+}
+
+
+// Spearman correlation of two score lists, 0 if either is constant
+static double rank_correlation(const long x[], const long y[]){
+    double x_ranks[POPULATION_SIZE], y_ranks[POPULATION_SIZE];
+    double mean = (POPULATION_SIZE - 1) / 2.0;
+    double xy = 0, xx = 0, yy = 0;
+    int i;
+
+    score_ranks(x, x_ranks);
+    score_ranks(y, y_ranks);
+    for (i = 0; i < POPULATION_SIZE; i++){
+        xy += (x_ranks[i] - mean) * (y_ranks[i] - mean);
+        xx += (x_ranks[i] - mean) * (x_ranks[i] - mean);
+        yy += (y_ranks[i] - mean) * (y_ranks[i] - mean);
+    }
+
+    return (xx > 0) && (yy > 0) ? xy / sqrt(xx * yy) : 0;
+}
+
+
+/*
+ * Checks a staged or racing evaluation against a full evaluation of the
+ * individuals it didn't run in full, whose scores are left as they were.
+ * The work of those individuals in the evaluation is in `metrics->screen`.
+ */
+static void audit_evaluation(transform_model* population[], const char* text,
+                             const language_model* model,
+                             const long screen_scores[],
+                             const int promoted[],
+                             struct generation_metrics* metrics){
+
+    transform_model* rest[POPULATION_SIZE];
+    long staged_scores[POPULATION_SIZE];
+    long full_scores[POPULATION_SIZE];
+    struct evaluation_work audit = { .cycles = 0 };
+    int i, rest_count = 0;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        if (!promoted[i]){
+            staged_scores[rest_count] = population[i]->score;
+            rest[rest_count++] = population[i];
+        }
+    }
+    run_and_score(rest, rest_count, text, MAX_CYCLES, model, &audit,
+                  NULL, NULL);
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        full_scores[i] = population[i]->score;
+    }
+    for (i = 0; i < rest_count; i++){
+        rest[i]->score = staged_scores[i];
+    }
+
+    // Promoted individuals among the best by the full evaluation
+    double ranks[POPULATION_SIZE];
+    int elite = 0, elite_promoted = 0, best_promoted = 0;
+    score_ranks(full_scores, ranks);
+    for (i = 0; i < POPULATION_SIZE; i++){
+        if (ranks[i] < SCREEN_AUDIT_ELITE){
+            elite++;
+            elite_promoted += promoted[i];
+        }
+        if (ranks[i] < 1){
+            best_promoted |= promoted[i];
+        }
+    }
+
+    unsigned long full_cycles = metrics->full.cycles + audit.cycles;
+    unsigned long staged_cycles = metrics->full.cycles + metrics->screen.cycles;
+
+    metrics->audited = 1;
+    metrics->audit_saved = full_cycles > 0
+        ? 1 - (double) staged_cycles / full_cycles : 0;
+    metrics->audit_recall = elite > 0 ? (double) elite_promoted / elite : 1;
+    metrics->audit_best_kept = best_promoted;
+    metrics->audit_rank_correlation = rank_correlation(screen_scores,
+                                                       full_scores);
+}
+
+
+// Screening result, sorted best first and then by position
+struct screen_rank {
+    long score;
+    int index;
+};
+
+
+static int screen_rank_cmp(const void* _a, const void* _b){
+    const struct screen_rank* a = _a;
+    const struct screen_rank* b = _b;
+
+    if (a->score != b->score){
+        return (a->score < b->score) - (a->score > b->score);
+    }
+
+    return a->index - b->index;
+}
+
+
+/*
+ * Staged evaluation: the population runs on a prefix of the text with a
+ * small cycle budget, then only the best of that screening run on the
+ * whole text. The others keep their screening score, capped below every
+ * promoted individual so they rank after them.
+ */
+static void evaluate_staged(transform_model* population[],
+                            const char* text,
+                            const char* screen_text,
+                            const language_model* model,
+                            const evolve_options* options, int audit,
+                            struct generation_metrics* metrics,
+                            perf_counters* perf,
+                            interpreter_profile* profile){
+
+    struct screen_rank ranked[POPULATION_SIZE];
+    transform_model* promoted[POPULATION_SIZE];
+    long screen_scores[POPULATION_SIZE];
+    int is_promoted[POPULATION_SIZE];
+    int i, promoted_count = 0;
+
+    run_and_score(population, POPULATION_SIZE, screen_text,
+                  options->screen_cycles, model, &metrics->screen,
+                  perf, profile);
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        screen_scores[i] = ranked[i].score = population[i]->score;
+        ranked[i].index = i;
+        is_promoted[i] = 0;
+    }
+    qsort(ranked, POPULATION_SIZE, sizeof(struct screen_rank),
+          screen_rank_cmp);
+
+    // The top share, whoever is close enough to the best screening and
+    // the elite (kept by the variation in the first position)
+    int top = ceil(options->screen_promote * POPULATION_SIZE);
+    long near_best = options->screen_margin > 0
+        ? (long) ceil(options->screen_margin * ranked[0].score)
+        : ranked[0].score + 1;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        long score = ranked[i].score;
+
+        is_promoted[ranked[i].index] = (i < top)
+            || ((score > 0) && (score >= near_best));
+    }
+    is_promoted[0] = 1;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        if (is_promoted[i]){
+            promoted[promoted_count++] = population[i];
+        }
+    }
+
+    run_and_score(promoted, promoted_count, text, MAX_CYCLES, model,
+                  &metrics->full, perf, profile);
+    metrics->promoted = promoted_count;
+
+    long lowest = promoted[0]->score;
+    for (i = 1; i < promoted_count; i++){
+        if (promoted[i]->score < lowest){
+            lowest = promoted[i]->score;
+        }
+    }
+    for (i = 0; i < POPULATION_SIZE; i++){
+        if ((!is_promoted[i]) && (population[i]->score >= lowest)){
+            population[i]->score = lowest > 0 ? lowest - 1 : 0;
+        }
+    }
+
+    if (audit){
+        audit_evaluation(population, text, model, screen_scores, is_promoted,
+                         metrics);
+    }
+}
+
 void shake(transform_model* population[]){
     int i;
     for (i = 0; i < POPULATION_SIZE; i++){
@@ -288,6 +895,22 @@ void shake(transform_model* population[]){
     }
 }
 
+// The cross alternates a symbol of each individual
+static void cross_over(transform_model* child, const transform_model* other){
+    const char* from = other->program;
+    char* to = child->program;
+
+    int pos;
+    for (pos = 0;
+         (from[pos] != '\0') && (from[pos + 1] != '\0')
+             && (to[pos] != '\0') && (to[pos + 1] != '\0');
+         pos += 2){
+
+        to[pos] = from[pos];
+
+    }
+}
+
 void cross(transform_model* population[], int iteration, const char* text){
     // Mutations of the first half, the worst, the more mutations
     int index;
@@ -313,20 +936,683 @@ void cross(transform_model* population[], int iteration, const char* text){
         population[index] = copy_model(population[i]);
         assert(population[index] != NULL);
 
-        char* from = population[j]->program;
-        char* to = population[index]->program;
+        cross_over(population[index], population[j]);
+    }
+}
+
+
+// Runs a program further, up to `max_cycles` cycles in total
+static void resume_program_run(struct program_run* run,
+                               transform_model* transform,
+                               unsigned long max_cycles){
+
+    run_slice(run, transform, max_cycles, NULL, NULL);
+}
+
+
+// Scores the output of runs so far, of the given individuals
+static void score_program_runs(struct program_run* runs[],
+                               transform_model* individuals[], int count,
+                               const language_model* model, long scores[]){
+
+    const char* outputs[POPULATION_SIZE];
+    size_t lengths[POPULATION_SIZE];
+    unsigned long raw_scores[POPULATION_SIZE];
+    int i;
+
+    for (i = 0; i < count; i++){
+        individuals[i]->output_size = runs[i]->output_size;
+        lengths[i] = output_text_length(individuals[i], runs[i]->output);
+        outputs[i] = runs[i]->output;
+    }
+
+    language_model_score_batch(model, outputs, lengths, count, raw_scores);
+
+    for (i = 0; i < count; i++){
+        scores[i] = crash_adjusted_score(individuals[i], runs[i]->crashed,
+                                         raw_scores[i]);
+    }
+}
+
+
+/*
+ * Racing evaluation (successive halving): everybody runs up to
+ * `race_cycles` cycles and is scored on the output so far, then the
+ * better half goes on with twice the budget, and so on until `race_keep`
+ * are left or the budget is the full one. Those run to the end. Dropped
+ * individuals keep their last score, capped below everyone who went
+ * further. With budgets in which every program ends, the ranking is the
+ * one of a full evaluation down to the dropped. Runs are resumed, so they
+ * can't be profiled.
+ */
+static void evaluate_racing(transform_model* population[],
+                            const char* text,
+                            const language_model* model,
+                            const evolve_options* options, int audit,
+                            struct generation_metrics* metrics,
+                            perf_counters* perf){
+
+    struct program_run runs[POPULATION_SIZE];
+    struct screen_rank ranked[POPULATION_SIZE];
+    long scores[POPULATION_SIZE];
+    int dropped_in[POPULATION_SIZE];  /* round, 0 for the survivors */
+    int i, round, racing = POPULATION_SIZE;
+    unsigned long budget = options->race_cycles;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        start_program_run(&runs[i], text);
+        ranked[i].index = i;
+        dropped_in[i] = 0;
+    }
+
+    double eval_seconds = 0, score_seconds = 0;
+    for (round = 1;; round++){
+        struct program_run* round_runs[POPULATION_SIZE];
+        transform_model* round_individuals[POPULATION_SIZE];
+        long round_scores[POPULATION_SIZE];
+        int finished = 1;
+
+        if (budget > MAX_CYCLES){
+            budget = MAX_CYCLES;
+        }
+
+        if (perf != NULL){
+            begin_perf_phase(perf);
+        }
+
+        double start = now();
+        for (i = 0; i < racing; i++){
+            int index = ranked[i].index;
+
+            resume_program_run(&runs[index], population[index], budget);
+            finished &= program_run_finished(&runs[index], population[index]);
+
+            round_runs[i] = &runs[index];
+            round_individuals[i] = population[index];
+        }
+        double scoring = now();
+
+        if (perf != NULL){
+            end_perf_phase(perf, PHASE_PROCESS);
+        }
+
+        score_program_runs(round_runs, round_individuals, racing, model,
+                           round_scores);
 
-        // The cross alternates a symbol of each individual
-        int pos;
-        for (pos = 0;
-             (from[pos] != '\0') && (from[pos + 1] != '\0')
-                 && (to[pos] != '\0') && (to[pos + 1] != '\0');
-             pos += 2){
+        if (perf != NULL){
+            end_perf_phase(perf, PHASE_SCORE);
+        }
+
+        for (i = 0; i < racing; i++){
+            ranked[i].score = scores[ranked[i].index] = round_scores[i];
+        }
+        qsort(ranked, racing, sizeof(struct screen_rank), screen_rank_cmp);
+
+        eval_seconds += scoring - start;
+        score_seconds += now() - scoring;
+
+        if (finished || (budget >= MAX_CYCLES)){
+            break;
+        }
+
+        // The survivors, then with the full budget
+        int keep = racing / 2;
+        if (keep <= options->race_keep){
+            keep = options->race_keep < racing ? options->race_keep : racing;
+            budget = MAX_CYCLES;
+        }
+        else {
+            budget *= 2;
+        }
+
+        for (i = keep; i < racing; i++){
+            dropped_in[ranked[i].index] = round;
+        }
+        racing = keep;
+    }
+
+    // Everybody below whoever went further: the survivors first, then
+    // the ones dropped last, keeping the order within each round
+    int rounds = round, step;
+    long cap = LONG_MAX;
+    for (step = 0; step < rounds; step++){
+        int group = step == 0 ? 0 : rounds - step;
+        long lowest = cap;
+
+        for (i = 0; i < POPULATION_SIZE; i++){
+            if (dropped_in[i] == group){
+                if (scores[i] > cap){
+                    scores[i] = cap;
+                }
+                if (scores[i] < lowest){
+                    lowest = scores[i];
+                }
+            }
+        }
+        cap = lowest > 0 ? lowest - 1 : 0;
+    }
+
+    int promoted[POPULATION_SIZE];
+    struct evaluation_work* work;
+    for (i = 0; i < POPULATION_SIZE; i++){
+        int crashed;
+
+        promoted[i] = dropped_in[i] == 0;
+        work = promoted[i] ? &metrics->full : &metrics->screen;
+        free(finish_program_run(&runs[i], population[i], &crashed));
+
+        population[i]->score = scores[i];
+        work->cycles += population[i]->cycles;
+        work->crashed += crashed;
+        work->capped += population[i]->cycles >= MAX_CYCLES;
+        metrics->promoted += promoted[i];
+    }
+    metrics->full.eval_seconds = eval_seconds;
+    metrics->full.score_seconds = score_seconds;
+    metrics->race_rounds = rounds;
+
+    if (audit){
+        audit_evaluation(population, text, model, scores, promoted, metrics);
+    }
+}
+
+
+static int hash_cmp(const void* _a, const void* _b){
+    hash_t a = *(const hash_t*) _a, b = *(const hash_t*) _b;
+
+    return (a > b) - (a < b);
+}
+
+
+// Different programs in the population, told apart by their hashes
+static int distinct_genomes(transform_model* population[]){
+    hash_t hashes[POPULATION_SIZE];
+    int i, distinct = 1;
+
+    for (i = 0; i < POPULATION_SIZE; i++){
+        hashes[i] = get_hash_n(population[i]->program,
+                               population[i]->program_size);
+    }
+    qsort(hashes, POPULATION_SIZE, sizeof(hash_t), hash_cmp);
+
+    for (i = 1; i < POPULATION_SIZE; i++){
+        distinct += hashes[i] != hashes[i - 1];
+    }
+
+    return distinct;
+}
+
+
+static void write_metrics_header(const evolve_options* options){
+    if (options->metrics_format == EVOLVE_METRICS_CSV){
+        dprintf(options->metrics_fd,
+                "generation,eval_ms,score_ms,selection_ms,variation_ms,"
+                "cycles,crashed,capped,best,median,worst,distinct,action,"
+                "screen_ms,screen_cycles,promoted,race_rounds,"
+                "audit_saved,audit_recall,audit_best_kept,audit_rank_corr\n");
+    }
+}
+
+
+static void write_metrics(const evolve_options* options, long iteration,
+                          const struct generation_metrics* metrics,
+                          int action){
+
+    const char* action_name = ((action >= 0) && (action <= EVOLVE_BUMP))
+        ? EVOLVE_ACTION_NAMES[action] : "unknown";
+    const struct evaluation_work* full = &metrics->full;
+    const struct evaluation_work* screen = &metrics->screen;
+
+    if (options->metrics_format == EVOLVE_METRICS_CSV){
+        dprintf(options->metrics_fd,
+                "%li,%.3f,%.3f,%.3f,%.3f,%lu,%i,%i,%li,%li,%li,%i,%s,"
+                "%.3f,%lu,%i,%i,",
+                iteration, full->eval_seconds * 1e3,
+                full->score_seconds * 1e3,
+                metrics->selection_seconds * 1e3,
+                metrics->variation_seconds * 1e3,
+                full->cycles, full->crashed, full->capped,
+                metrics->best, metrics->median, metrics->worst,
+                metrics->distinct, action_name,
+                (screen->eval_seconds + screen->score_seconds) * 1e3,
+                screen->cycles, metrics->promoted, metrics->race_rounds);
+
+        if (metrics->audited){
+            dprintf(options->metrics_fd, "%.4f,%.4f,%i,%.4f\n",
+                    metrics->audit_saved, metrics->audit_recall,
+                    metrics->audit_best_kept,
+                    metrics->audit_rank_correlation);
+        }
+        else {
+            dprintf(options->metrics_fd, ",,,\n");
+        }
+    }
+    else {
+        dprintf(options->metrics_fd,
+                "{\"generation\": %li, \"eval_ms\": %.3f, \"score_ms\": %.3f, "
+                "\"selection_ms\": %.3f, \"variation_ms\": %.3f, "
+                "\"cycles\": %lu, \"crashed\": %i, \"capped\": %i, "
+                "\"best\": %li, \"median\": %li, \"worst\": %li, "
+                "\"distinct\": %i, \"action\": \"%s\", "
+                "\"screen_ms\": %.3f, \"screen_cycles\": %lu, "
+                "\"promoted\": %i, \"race_rounds\": %i",
+                iteration, full->eval_seconds * 1e3,
+                full->score_seconds * 1e3,
+                metrics->selection_seconds * 1e3,
+                metrics->variation_seconds * 1e3,
+                full->cycles, full->crashed, full->capped,
+                metrics->best, metrics->median, metrics->worst,
+                metrics->distinct, action_name,
+                (screen->eval_seconds + screen->score_seconds) * 1e3,
+                screen->cycles, metrics->promoted, metrics->race_rounds);
+
+        if (metrics->audited){
+            dprintf(options->metrics_fd,
+                    ", \"audit_saved\": %.4f, \"audit_recall\": %.4f, "
+                    "\"audit_best_kept\": %s, \"audit_rank_corr\": %.4f",
+                    metrics->audit_saved, metrics->audit_recall,
+                    metrics->audit_best_kept ? "true" : "false",
+                    metrics->audit_rank_correlation);
+        }
+        dprintf(options->metrics_fd, "}\n");
+    }
+}
+
+
+void evolve_default_options(evolve_options* options){
+    options->show_interval = SHOW_INTERVAL;
+    options->metrics_fd = -1;
+    options->metrics_format = EVOLVE_METRICS_JSON;
+    options->perf_interval = 0;
+    options->alloc_interval = 0;
+    options->profile = NULL;
+    options->screen_prefix = 0;
+    options->screen_cycles = SCREEN_CYCLES;
+    options->screen_promote = SCREEN_PROMOTE;
+    options->screen_margin = SCREEN_MARGIN;
+    options->race_cycles = 0;
+    options->race_keep = RACE_KEEP;
+    options->audit_interval = 0;
+    options->steady_workers = 0;
+}
+
+
+static void report_phase_counters(perf_counters* perf, long first, long last){
+    char title[48];
+
+    snprintf(title, sizeof(title), "gen %li-%li", first, last);
+    report_perf_counters(perf, stderr, title, EVOLVE_PHASE_NAMES);
+}
+
+
+// Reports the allocations since `since`, which then moves to now
+static void report_generation_allocs(alloc_snapshot_t* since,
+                                     long first, long last){
+    alloc_snapshot_t until;
+    char title[48];
+
+    take_alloc_snapshot(&until);
+    snprintf(title, sizeof(title), "gen %li-%li", first, last);
+    report_alloc_stats(stderr, title, since, &until, last - first + 1);
+
+    reset_alloc_peaks();
+    take_alloc_snapshot(since);
+}
+
+
+// Progress line of the winner, `better` (its output) gets mangled
+static void show_progress(long iteration, const transform_model* winner,
+                          char* better){
+
+    int limit = strlen(better);
+    // Make the “better” string readable
+    if (limit > 50){
+        strcpy(&better[40],
+               "\x1b[7m%\x1b[0m");
+
+        limit = 40;
+    }
+
+    int i;
+    for (i = 0; i < limit; i++){
+        if ((!isalnum(better[i])) && (!ispunct(better[i])) && (better[i] != ' ')){
+
+            better[i] = '.';
+        }
+    }
+
+    printf("Iteration (%5li) [%5li | %3li]: |\x1b[1m%s\x1b[0m|\n",
+           iteration, winner->score,
+           winner->output_size, better);
+}
+
+
+/*
+ * Steady-state evolution: worker threads take offspring from a queue,
+ * evaluate them and put them in the population by tournament replacement,
+ * while the calling thread selects and breeds more. Nobody waits for the
+ * slowest individual of a generation; every POPULATION_SIZE evaluations
+ * count as one for the controller and the metrics.
+ */
+struct steady_state {
+    const char* text;
+    const language_model* model;
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued;    /* offspring in the queue, or closing */
+    pthread_cond_t dequeued;  /* room in the queue */
+    pthread_cond_t inserted;  /* population members */
+
+    // Offspring to evaluate, a ring
+    transform_model** queue;
+    int queue_size, queue_start, queue_count;
+    int closing;
+
+    transform_model** population;
+    int filled;  /* members, up to POPULATION_SIZE */
+
+    unsigned long evaluations;
+    struct evaluation_work work;  /* since the last generation */
+};
+
+struct steady_worker {
+    pthread_t thread;
+    struct steady_state* state;
+    unsigned int seed;
+};
+
+
+// Enqueues an offspring to evaluate, waiting for room
+static void steady_push(struct steady_state* state, transform_model* child){
+    pthread_mutex_lock(&state->lock);
+    while (state->queue_count == state->queue_size){
+        pthread_cond_wait(&state->dequeued, &state->lock);
+    }
+
+    state->queue[(state->queue_start + state->queue_count++)
+                 % state->queue_size] = child;
+
+    pthread_cond_signal(&state->queued);
+    pthread_mutex_unlock(&state->lock);
+}
+
+
+/*
+ * Fills the population, then replaces the worst of STEADY_TOURNAMENT
+ * random members if the child scores as well or better. Locked.
+ */
+static void steady_insert(struct steady_state* state, transform_model* child,
+                          unsigned int* seed){
+
+    if (state->filled < POPULATION_SIZE){
+        state->population[state->filled++] = child;
+        return;
+    }
+
+    int i, loser = rand_r(seed) % POPULATION_SIZE;
+    for (i = 1; i < STEADY_TOURNAMENT; i++){
+        int index = rand_r(seed) % POPULATION_SIZE;
+
+        if (state->population[index]->score < state->population[loser]->score){
+            loser = index;
+        }
+    }
+
+    if (child->score >= state->population[loser]->score){
+        free_transform_model(state->population[loser]);
+        state->population[loser] = child;
+    }
+    else {
+        free_transform_model(child);
+    }
+}
+
+
+static void* steady_work(void* arg){
+    struct steady_worker* worker = arg;
+    struct steady_state* state = worker->state;
+
+    for (;;){
+        pthread_mutex_lock(&state->lock);
+        while ((state->queue_count == 0) && !state->closing){
+            pthread_cond_wait(&state->queued, &state->lock);
+        }
+        if (state->closing){
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+
+        transform_model* child = state->queue[state->queue_start];
+        state->queue_start = (state->queue_start + 1) % state->queue_size;
+        state->queue_count--;
+        pthread_cond_signal(&state->dequeued);
+        pthread_mutex_unlock(&state->lock);
+
+        struct evaluation_work work = { .eval_seconds = 0 };
+        run_and_score(&child, 1, state->text, MAX_CYCLES, state->model,
+                      &work, NULL, NULL);
+
+        pthread_mutex_lock(&state->lock);
+        steady_insert(state, child, &worker->seed);
+
+        state->evaluations++;
+        state->work.eval_seconds += work.eval_seconds;
+        state->work.score_seconds += work.score_seconds;
+        state->work.cycles += work.cycles;
+        state->work.crashed += work.crashed;
+        state->work.capped += work.capped;
+
+        pthread_cond_signal(&state->inserted);
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    return NULL;
+}
+
+
+// Best of STEADY_TOURNAMENT random members, copied. Locked.
+static transform_model* steady_select(struct steady_state* state){
+    int i, winner = rand() % state->filled;
+
+    for (i = 1; i < STEADY_TOURNAMENT; i++){
+        int index = rand() % state->filled;
+
+        if (state->population[index]->score > state->population[winner]->score){
+            winner = index;
+        }
+    }
+
+    transform_model* copy = copy_model(state->population[winner]);
+    assert(copy != NULL);
 
-            to[pos] = from[pos];
+    return copy;
+}
+
+
+static transform_model* evolve_steady(
+    const language_model* model,
+    const char* text,
+    int (*controller) (
+        int iteration, transform_model* transform,
+        const char* better_output, unsigned long score),
+    const evolve_options* options, evolve_stats* stats){
+
+    const int population_count = POPULATION_SIZE;
+    transform_model* population[population_count];
+    const int workers_count = options->steady_workers;
+    struct steady_worker workers[workers_count];
+
+    struct steady_state state = {
+        .text = text,
+        .model = model,
+        .queue_size = STEADY_QUEUE_PER_WORKER * workers_count,
+        .population = population,
+    };
+    state.queue = malloc(sizeof(transform_model*) * state.queue_size);
+    assert(state.queue != NULL);
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.queued, NULL);
+    pthread_cond_init(&state.dequeued, NULL);
+    pthread_cond_init(&state.inserted, NULL);
+
+    int i, started, error = 0;
+    for (started = 0; started < workers_count; started++){
+        workers[started].state = &state;
+        workers[started].seed = rand();
+
+        error = pthread_create(&workers[started].thread, NULL, steady_work,
+                               &workers[started]);
+        if (error != 0){
+            break;
+        }
+    }
+
+    transform_model* winner = NULL;
+    if (started == 0){
+        errno = error;
+    }
+    else {
+        if (options->metrics_fd >= 0){
+            write_metrics_header(options);
+        }
+
+        // Initial population
+        for (i = 0; i < population_count; i++){
+            steady_push(&state, random_transform());
+        }
+    }
+
+    long iteration;
+    int done = started == 0;
+    double selection_seconds = 0, variation_seconds = 0;
+    for (iteration = 0; !done;){
+        pthread_mutex_lock(&state.lock);
+        while (state.filled == 0){
+            pthread_cond_wait(&state.inserted, &state.lock);
+        }
+
+        if ((state.evaluations < (iteration + 1) * population_count)
+            || (state.filled < population_count)){
+
+            // Breed another
+            double selection = now();
+            transform_model* child = steady_select(&state);
+            transform_model* other = (rand() % 2) ? steady_select(&state) : NULL;
+            pthread_mutex_unlock(&state.lock);
+
+            double variation = now();
+            if (other != NULL){
+                cross_over(child, other);
+                free_transform_model(other);
+            }
+            mutate(child, population_count
+                   / (1 + rand() % (population_count - 1)));
+
+            selection_seconds += variation - selection;
+            variation_seconds += now() - variation;
+
+            steady_push(&state, child);
+            continue;
+        }
 
+        // A generation worth of evaluations
+        struct generation_metrics metrics = {
+            .full = state.work,
+            .promoted = state.evaluations - iteration * population_count,
+            .selection_seconds = selection_seconds,
+            .variation_seconds = variation_seconds,
+        };
+        memset(&state.work, 0, sizeof(state.work));
+        selection_seconds = variation_seconds = 0;
+
+        qsort(population, population_count, sizeof(transform_model*),
+              inv_language_score_cmp);
+        metrics.best = population[0]->score;
+        metrics.median = population[population_count / 2]->score;
+        metrics.worst = population[population_count - 1]->score;
+        if (options->metrics_fd >= 0){
+            metrics.distinct = distinct_genomes(population);
+        }
+
+        free_transform_model(winner);
+        winner = copy_model(population[0]);
+        assert(winner != NULL);
+        pthread_mutex_unlock(&state.lock);
+
+        char* better = process(winner, text, model);
+        int action = controller(iteration, winner, better, winner->score);
+
+        if ((options->show_interval > 0)
+            && ((iteration % options->show_interval) == 0)) {
+
+            show_progress(iteration, winner, better);
+        }
+        free(better);
+
+        switch(action){
+        case EVOLVE_SHAKE:
+        case EVOLVE_BUMP:
+        {
+            // Everybody mutated is a new population to evaluate
+            transform_model* shaken[population_count];
+
+            pthread_mutex_lock(&state.lock);
+            memcpy(shaken, population,
+                   sizeof(transform_model*) * population_count);
+            state.filled = 0;
+            pthread_mutex_unlock(&state.lock);
+
+            for (i = 0; i < population_count; i++){
+                mutate(shaken[i], MAX_MUTATION_RATE);
+                steady_push(&state, shaken[i]);
+            }
         }
+
+        case EVOLVE_CONTINUE:
+            break;
+
+        case EVOLVE_DONE:
+            done = 1;
+            break;
+
+        default:
+            printf("Unknown action code: %i\n", action);
+        }
+
+        if (options->metrics_fd >= 0){
+            write_metrics(options, iteration, &metrics, action);
+        }
+        iteration++;
+    }
+
+    // Stop the workers, then free whatever is left
+    pthread_mutex_lock(&state.lock);
+    state.closing = 1;
+    pthread_cond_broadcast(&state.queued);
+    pthread_mutex_unlock(&state.lock);
+
+    for (i = 0; i < started; i++){
+        pthread_join(workers[i].thread, NULL);
     }
+
+    for (i = 0; i < state.queue_count; i++){
+        free_transform_model(state.queue[(state.queue_start + i)
+                                         % state.queue_size]);
+    }
+    for (i = 0; i < state.filled; i++){
+        free_transform_model(population[i]);
+    }
+    free(state.queue);
+
+    pthread_cond_destroy(&state.inserted);
+    pthread_cond_destroy(&state.dequeued);
+    pthread_cond_destroy(&state.queued);
+    pthread_mutex_destroy(&state.lock);
+
+    stats->generations = iteration;
+    stats->evaluations = state.evaluations;
+
+    return winner;
 }
 
 
@@ -337,6 +1623,32 @@ transform_model* evolve_transform(
         int iteration, transform_model* transform,
         const char* better_output, unsigned long score)){
 
+    evolve_options options;
+    evolve_default_options(&options);
+
+    return evolve_transform_with_options(model, text, controller,
+                                         &options, NULL);
+}
+
+
+transform_model* evolve_transform_with_options(
+    const language_model* model,
+    const char* text,
+    int (*controller) (
+        int iteration, transform_model* transform,
+        const char* better_output, unsigned long score),
+    const evolve_options* options, evolve_stats* stats){
+
+    evolve_stats local_stats;
+    if (stats == NULL){
+        stats = &local_stats;
+    }
+    stats->generations = stats->evaluations = stats->screenings = 0;
+
+    if (options->steady_workers > 0){
+        return evolve_steady(model, text, controller, options, stats);
+    }
+
     const int population_count = POPULATION_SIZE;
     transform_model* population[population_count];
 
@@ -349,21 +1661,82 @@ transform_model* evolve_transform(
     }
 
 
+    if (options->metrics_fd >= 0){
+        write_metrics_header(options);
+    }
+
+    perf_counters* perf = NULL;
+    if (options->perf_interval > 0){
+        perf = open_perf_counters(PHASE_COUNT);
+        if (perf == NULL){
+            fprintf(stderr, "Performance counters unavailable: %s\n",
+                    strerror(errno));
+        }
+    }
+
+    // From here on, allocations should be the same every generation
+    int count_allocs = options->alloc_interval > 0;
+    alloc_snapshot_t alloc_since;
+    if (count_allocs && !alloc_stats_enabled()){
+        fprintf(stderr, "Allocation counts unavailable: "
+                "built without ALLOC_STATS\n");
+        count_allocs = 0;
+    }
+    if (count_allocs){
+        reset_alloc_peaks();
+        take_alloc_snapshot(&alloc_since);
+    }
+
+    // Staged evaluation screens on a prefix, shorter than the text
+    char* screen_text = NULL;
+    if ((options->screen_prefix > 0)
+        && (options->screen_prefix < strlen(text))){
+
+        screen_text = strndup(text, options->screen_prefix);
+        assert(screen_text != NULL);
+    }
+
     long iteration;
     int done = 0;
     for (iteration = 0;!done;iteration++){
-        {
-            int i;
-            for (i = 0; i < population_count; i++){
-                char* out = process(population[i], text, model);
-                free(out);
-            }
+        struct generation_metrics metrics = { .promoted = 0 };
+
+        int audit = (options->audit_interval > 0)
+            && ((iteration % options->audit_interval) == 0);
+
+        if (screen_text != NULL){
+            evaluate_staged(population, text, screen_text, model, options,
+                            audit, &metrics, perf, options->profile);
+            stats->screenings += population_count;
         }
+        else if (options->race_cycles > 0){
+            evaluate_racing(population, text, model, options, audit,
+                            &metrics, perf);
+            stats->screenings += population_count;
+        }
+        else {
+            evaluate_population(population, text, model, &metrics, perf,
+                                options->profile);
+        }
+        stats->generations++;
+        stats->evaluations += metrics.promoted;
 
+        if (options->metrics_fd >= 0){
+            metrics.distinct = distinct_genomes(population);
+        }
 
+        if (perf != NULL){
+            begin_perf_phase(perf);
+        }
+
+        double selection = now();
         qsort(&population, population_count, sizeof(transform_model*),
               inv_language_score_cmp);
 
+        if (perf != NULL){
+            end_perf_phase(perf, PHASE_VARIATION);
+        }
+
 
 
         {
@@ -371,34 +1744,27 @@ transform_model* evolve_transform(
             char* better = process(winner, text, model);
 
             int action = controller(iteration, winner, better, winner->score);
+            metrics.selection_seconds = now() - selection;
+            metrics.best = population[0]->score;
+            metrics.median = population[population_count / 2]->score;
+            metrics.worst = population[population_count - 1]->score;
 
-            if ((iteration % SHOW_INTERVAL) == 0) {
+            if ((options->show_interval > 0)
+                && ((iteration % options->show_interval) == 0)) {
 
-                int limit = strlen(better);
-                // Make the “better” string readable
-                if (limit > 50){
-                    strcpy(&better[40],
-                           "\x1b[7m%\x1b[0m");
-
-                    limit = 40;
-                }
-
-                int i;
-                for (i = 0; i < limit; i++){
-                    if ((!isalnum(better[i])) && (!ispunct(better[i])) && (better[i] != ' ')){
+                show_progress(iteration, winner, better);
+            }
 
-                        better[i] = '.';
-                    }
-                }
+            free(better);
 
-                printf("Iteration (%5li) [%5li | %3li]: |\x1b[1m%s\x1b[0m|\n",
-                       iteration, winner->score,
-                       winner->output_size, better);
+            if (perf != NULL){
+                begin_perf_phase(perf);
             }
 
-            free(better);
+            double variation = now();
             switch(action){
             case EVOLVE_SHAKE:
+            case EVOLVE_BUMP:
                 shake(population);
 
             case EVOLVE_CONTINUE:
@@ -412,9 +1778,34 @@ transform_model* evolve_transform(
             default:
                 printf("Unknown action code: %i\n", action);
             }
+            metrics.variation_seconds = now() - variation;
+
+            if (perf != NULL){
+                end_perf_phase(perf, PHASE_VARIATION);
+
+                if (done || ((iteration + 1) % options->perf_interval) == 0){
+                    report_phase_counters(
+                        perf, iteration - iteration % options->perf_interval,
+                        iteration);
+                }
+            }
+
+            if (count_allocs
+                && (done || ((iteration + 1) % options->alloc_interval) == 0)){
+                report_generation_allocs(
+                    &alloc_since,
+                    iteration - iteration % options->alloc_interval, iteration);
+            }
+
+            if (options->metrics_fd >= 0){
+                write_metrics(options, iteration, &metrics, action);
+            }
         }
     }
 
+    close_perf_counters(perf);
+    free(screen_text);
+
     // Free population
     {
         int i;
@@ -427,6 +1818,16 @@ transform_model* evolve_transform(
 }
 
 
+unsigned long transform_model_cycles(const transform_model* model){
+    return model->cycles;
+}
+
+
+long transform_model_score(const transform_model* model){
+    return model->score;
+}
+
+
 void free_transform_model(transform_model* model){
     if (model != NULL){
         free(model->program);
@@ -437,11 +1838,16 @@ void free_transform_model(transform_model* model){
 
 
 void show_transform_model(transform_model* model){
+    write_transform_model(model, stdout);
+}
+
+
+void write_transform_model(transform_model* model, FILE* f){
     if (model == NULL){
-        printf("(null)");
+        fprintf(f, "(null)");
         return;
     }
 
-    printf("[Sc: %li |Sz: %li]\n\x1b[1m%s\x1b[0m\n",
-           model->score, model->output_size, model->program);
+    fprintf(f, "[Sc: %li |Sz: %li]\n\x1b[1m%s\x1b[0m\n",
+            model->score, model->output_size, model->program);
 }
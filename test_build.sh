@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+
+set -euo pipefail
+
+# Remake
+make clean
+make
+make bench
+
+# Sharded builds must match the serial one
+echo -e "\n\n\x1b[7mSerial vs parallel build\x1b[0m"
+bin/happy-bench build dictionary 1 2 4 8 | tee /dev/stderr | (! grep DIFFERENT)
+
+# Key enumeration and frozen table reloads must keep every key
+echo -e "\n\n\x1b[7mHash tables\x1b[0m"
+bin/happy-bench hash dictionary
+
+# The concurrent table must count as the one behind a lock
+echo -e "\n\n\x1b[7mConcurrent table\x1b[0m"
+bin/happy-bench concurrent dictionary 1 4 8
+
+# Fixed point scores must stay within tolerance, long garbage included
+echo -e "\n\n\x1b[7mFloating vs fixed point\x1b[0m"
+bin/happy-bench fixed dictionary
+
+# A match covering several (chained or nested) ones replaces them all, so
+# garbage after them can't raise the score
+echo -e "\n\n\x1b[7mOverlapping automaton matches\x1b[0m\n"
+corpus=`mktemp`
+trap 'rm -f "$corpus"' EXIT
+echo -e "flag stars are made of weird stuff\nabc def cde abcdefg" > "$corpus"
+for text in abcdefg abcdef; do
+    wordScore=`bin/happy -w automaton score "$corpus" "$text"`
+    garbageScore=`bin/happy -w automaton score "$corpus" "${text}xyz"`
+    echo "[$text] $wordScore > $garbageScore"
+    [ $wordScore -gt $garbageScore ]
+done
+
+# Dictionary words are alphanumeric, so matches may cover digits too
+echo -e "flag stars are made of weird stuff\nr2d2 met c3po in 2015" > "$corpus"
+for text in "r2d2 met c3po" "r2d2 in 2015"; do
+    wordScore=`bin/happy -w automaton score "$corpus" "$text"`
+    garbageScore=`bin/happy -w automaton score "$corpus" "${text}xyz"`
+    echo "[$text] $wordScore > $garbageScore"
+    [ $wordScore -gt $garbageScore ]
+done
+
+# Merged corpora
+echo -e "\n\n\x1b[7mMerging corpora\x1b[0m\n"
+check="flag stars are made of weird stuff"
+dictScore=`bin/happy score dictionary "$check"`
+mergedScore=`bin/happy -j 4 score dictionary,examples/gutenberg/cosmos.txt "$check"`
+echo "$dictScore | $mergedScore"
+[ $mergedScore -gt 0 ]
+
+echo -e '\nGreat!'